@@ -0,0 +1,266 @@
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+#include <TEfficiency.h>
+#include <TGraphErrors.h>
+#include <TRandom3.h>
+#include "Integration.hpp"
+#include "Interpolator.hpp"
+#include "ISRSolverSLE.hpp"
+#include "ISRSolverTikhonov.hpp"
+#include "ISRSolverTSVD.hpp"
+#include "KuraevFadin.hpp"
+#include "Utils.hpp"
+
+/**
+ * Synthetic inputs: a phi-like resonance on top of a smooth continuum.
+ * Everything is generated in memory, no .root files are needed.
+ */
+namespace {
+const double kThreshold = 0.27;
+const double kMinEnergy = 0.6;
+const double kMaxEnergy = 2.0;
+
+double modelBornCS(double energy) {
+  if (energy <= kThreshold) {
+    return 0.;
+  }
+  const double mass = 1.019;
+  const double width = 0.0043;
+  const double s = energy * energy;
+  const double bw = mass * mass * width * width /
+                    ((s - mass * mass) * (s - mass * mass) + mass * mass * width * width);
+  return 1000. * bw + 10. / s;
+}
+
+double modelEfficiency(double x, double energy) {
+  return 0.8 * (1. - 0.5 * x) * (1. - 0.05 * energy);
+}
+
+/**
+ * Synthetic data set with n center-of-mass energy points
+ */
+typedef struct {
+  Eigen::VectorXd ecm;
+  Eigen::VectorXd ecmErr;
+  Eigen::VectorXd vcs;
+  Eigen::VectorXd vcsErr;
+} SyntheticData;
+
+SyntheticData makeSyntheticData(std::size_t n) {
+  SyntheticData data;
+  data.ecm.resize(n);
+  data.ecmErr.resize(n);
+  data.vcs.resize(n);
+  data.vcsErr.resize(n);
+  const double step = (kMaxEnergy - kMinEnergy) / (n - 1);
+  for (std::size_t i = 0; i < n; ++i) {
+    data.ecm(i) = kMinEnergy + step * i;
+    data.ecmErr(i) = 1.e-3;
+    // The Born cross section is a good enough stand-in for the visible one
+    data.vcs(i) = modelBornCS(data.ecm(i));
+    data.vcsErr(i) = 0.01 * data.vcs(i);
+  }
+  return data;
+}
+
+template <class T>
+std::unique_ptr<T> makeSolver(SyntheticData* data, bool energySpread = false) {
+  std::unique_ptr<T> solver(new T(data->ecm.size(),
+                                  data->ecm.data(), data->vcs.data(),
+                                  data->ecmErr.data(), data->vcsErr.data(),
+                                  kThreshold, modelEfficiency));
+  if (energySpread) {
+    solver->enableEnergySpread();
+  } else {
+    solver->disableEnergySpread();
+  }
+  return solver;
+}
+
+/**
+ * Gives access to the energy spread matrix of the solver
+ */
+class BenchSLE : public ISRSolverSLE {
+ public:
+  using ISRSolverSLE::ISRSolverSLE;
+  Eigen::MatrixXd energySpreadMatrix() const {
+    return _energySpreadMatrix();
+  }
+};
+
+std::vector<std::tuple<bool, int, int>> cubicSettings(int n) {
+  return std::vector<std::tuple<bool, int, int>>(
+      1, std::tuple<bool, int, int>(true, 0, n - 1));
+}
+}  // namespace
+
+/**
+ * Micro-benchmarks
+ */
+static void BM_KernelKuraevFadin(benchmark::State& state) {
+  const double s = 1.02 * 1.02;
+  double x = 1.e-4;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernelKuraevFadin(x, s));
+    x = x < 0.9 ? x * 1.01 : 1.e-4;
+  }
+}
+BENCHMARK(BM_KernelKuraevFadin);
+
+static void BM_ConvolutionKuraevFadin(benchmark::State& state) {
+  const double energy = 1.1;
+  const double maxX = 1. - kThreshold * kThreshold / energy / energy;
+  std::function<double(double)> fcn = modelBornCS;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        convolutionKuraevFadin(energy, fcn, 0, maxX, modelEfficiency));
+  }
+}
+BENCHMARK(BM_ConvolutionKuraevFadin)->Unit(benchmark::kMicrosecond);
+
+static void BM_GaussianConv(benchmark::State& state) {
+  std::function<double(double)> fcn = modelBornCS;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gaussian_conv(1.019, 1.e-6, fcn));
+  }
+}
+BENCHMARK(BM_GaussianConv);
+
+static void BM_Integrate(benchmark::State& state) {
+  std::function<double(double)> fcn = modelBornCS;
+  double error;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(integrate(fcn, kMinEnergy, kMaxEnergy, error));
+  }
+}
+BENCHMARK(BM_Integrate)->Unit(benchmark::kMicrosecond);
+
+static void BM_BasisEval(benchmark::State& state) {
+  const int n = state.range(0);
+  const bool cubic = state.range(1);
+  const auto data = makeSyntheticData(n);
+  const Interpolator interp = cubic ?
+      Interpolator(cubicSettings(n), data.ecm, kThreshold) :
+      Interpolator(data.ecm, kThreshold);
+  const int csIndex = n / 2;
+  double energy = kThreshold;
+  const double step = (kMaxEnergy - kThreshold) / 1000;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(interp.basisEval(csIndex, energy));
+    energy = energy < kMaxEnergy ? energy + step : kThreshold;
+  }
+}
+BENCHMARK(BM_BasisEval)
+->ArgNames({"N", "cubic"})
+->Args({100, 0})
+->Args({100, 1});
+
+static void BM_TEfficiencyLookup(benchmark::State& state) {
+  const int nx = 50;
+  const int ne = 100;
+  TEfficiency eff("bench_eff", "", nx, 0., 1., ne, kMinEnergy, kMaxEnergy);
+  for (int ix = 1; ix <= nx; ++ix) {
+    for (int ie = 1; ie <= ne; ++ie) {
+      const int bin = eff.GetGlobalBin(ix, ie);
+      eff.SetTotalEvents(bin, 1000);
+      eff.SetPassedEvents(bin, 800);
+    }
+  }
+  auto data = makeSyntheticData(50);
+  TGraphErrors vcsGraph(data.ecm.size(), data.ecm.data(), data.vcs.data(),
+                        data.ecmErr.data(), data.vcsErr.data());
+  ISRSolverSLE solver(&vcsGraph, &eff, kThreshold);
+  const auto& efficiency = solver.efficiency();
+  double x = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(efficiency(x, 1.1));
+    x = x < 0.99 ? x + 0.001 : 0.;
+  }
+}
+BENCHMARK(BM_TEfficiencyLookup);
+
+/**
+ * Macro-benchmarks
+ */
+static void BM_EvalEqMatrix(benchmark::State& state) {
+  auto data = makeSyntheticData(state.range(0));
+  auto solver = makeSolver<ISRSolverSLE>(&data);
+  for (auto _ : state) {
+    solver->evalEqMatrix();
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_EvalEqMatrix)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond)
+->Complexity();
+
+static void BM_EnergySpreadMatrix(benchmark::State& state) {
+  auto data = makeSyntheticData(state.range(0));
+  auto solver = makeSolver<BenchSLE>(&data, true);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(solver->energySpreadMatrix());
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_EnergySpreadMatrix)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond)
+->Complexity();
+
+/**
+ * Solver benchmarks time solve() with the integral operator matrix
+ * already prepared
+ */
+template <class T>
+static void BM_Solve(benchmark::State& state) {
+  auto data = makeSyntheticData(state.range(0));
+  auto solver = makeSolver<T>(&data);
+  solver->solve();
+  for (auto _ : state) {
+    solver->solve();
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Solve, ISRSolverSLE)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond)
+->Complexity();
+BENCHMARK_TEMPLATE(BM_Solve, ISRSolverTikhonov)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond)
+->Complexity();
+BENCHMARK_TEMPLATE(BM_Solve, ISRSolverTSVD)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond)
+->Complexity();
+
+/**
+ * One toy MC draw per iteration, as in the chi-square and ratio tests
+ */
+template <class T>
+static void BM_ToyMC(benchmark::State& state) {
+  auto data = makeSyntheticData(state.range(0));
+  auto solver = makeSolver<T>(&data);
+  solver->solve();
+  gRandom->SetSeed(1);
+  for (auto _ : state) {
+    solver->resetVisibleCS(randomDrawVisCS(data.vcs, data.vcsErr));
+    solver->solve();
+    benchmark::DoNotOptimize(solver->bcs().data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ToyMC, ISRSolverSLE)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ToyMC, ISRSolverTikhonov)
+->Arg(50)->Arg(100)->Arg(300)
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
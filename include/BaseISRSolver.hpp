@@ -4,6 +4,7 @@
 #include <Eigen/Dense>
 #include <string>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <TGraphErrors.h>
 #include <TEfficiency.h>
@@ -27,6 +28,26 @@ typedef struct : std::exception {
   }
 } EfficiencyDimensionException;
 
+/**
+ * The exception that is thrown when the visible cross section covariance
+ * matrix has the wrong size or is not positive definite
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Wrong visible cross section covariance matrix.\n";
+  }
+} VCSCovMatrixException;
+
+/**
+ * The exception that is thrown when a center-of-mass energy point can not
+ * be inserted (below threshold or duplicated) or removed (wrong index)
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Wrong center-of-mass energy point.\n";
+  }
+} EnergyPointException;
+
 /**
  * Solver base class
  */
@@ -42,7 +63,9 @@ class BaseISRSolver {
    * Constructor
    * @param inputPath an input path to .root file that contains visible
    * cross section in a form of TGraphErrors object and detection
-   * efficiency (if needed) in a form of 1D or 2D TEfficiency object
+   * efficiency (if needed) in a form of 1D or 2D TEfficiency object,
+   * or to a binary columnar .isrbin file with the same objects
+   * @see ColumnarIO.hpp
    * @param inputOpts an input options that contain a name of the
    *  detection efficiency TEfficiency object, a name of the visible
    * cross section TGraphErrors object, a threshold energy
@@ -146,10 +169,28 @@ class BaseISRSolver {
   void resetVisibleCS(const Eigen::VectorXd& vecVCS);
   /**
    * This method is used to reset visible cross section errors.
+   * Errors are treated as uncorrelated after this call.
    * @param vecVCSErr a vector of visible cross section errors
    at each center-of-mass energy point.
    */
   void resetVisibleCSErrors(const Eigen::VectorXd& vecVCSErr);
+  /**
+   * This method is used to set a full visible cross section covariance
+   * matrix (correlated errors). The matrix is factorized once by the
+   * Cholesky decomposition. Visible cross section errors are set to
+   * the square roots of the diagonal elements.
+   * @param covMatrix a covariance matrix in ascending order
+   of center-of-mass energy
+   */
+  void setVisibleCSCovMatrix(const Eigen::MatrixXd& covMatrix);
+  /**
+   * Returns true if a full visible cross section covariance matrix is used
+   */
+  bool isVisibleCSCovMatrixFull() const;
+  /**
+   * Visible cross section covariance matrix getter
+   */
+  Eigen::MatrixXd getVisibleCSCovMatrix() const;
   /**
    * This method is used to reset center-of-mass energy errors.
    * @param vecECMErr a vector of center-of-mass energy errors.
@@ -216,18 +257,99 @@ class BaseISRSolver {
    */
   Eigen::VectorXd& _bcs();
   /**
-   * Visible cross section error getter in a form of covariance matrix
+   * Multiply a matrix by L^-1, where C = L L^T is the Cholesky
+   * decomposition of the visible cross section covariance matrix,
+   * so that (L^-1 A)^T (L^-1 A) = A^T C^-1 A. With uncorrelated
+   * errors rows are divided by the errors and no N x N matrix is formed.
+   * @param mx a matrix with the number of rows equal to the number of points
    */
-  Eigen::MatrixXd _vcsInvCovMatrix() const;
+  Eigen::MatrixXd _vcsWhiten(const Eigen::MatrixXd& mx) const;
+  /**
+   * Multiply a vector by L^-1
+   * @param vec a vector
+   */
+  Eigen::VectorXd _vcsWhiten(const Eigen::VectorXd& vec) const;
+  /**
+   * Multiply a vector by L^-1 in place (no heap allocation)
+   * @param vec a vector
+   */
+  void _vcsWhitenInPlace(Eigen::VectorXd* vec) const;
+  /**
+   * Full visible cross section covariance matrix const getter
+   * (empty if errors are uncorrelated)
+   */
+  const Eigen::MatrixXd& _getVCSCovMatrix() const;
+  /**
+   * Version of visible cross section errors, which is incremented
+   * each time the errors or the covariance matrix are changed.
+   * Solvers use it to keep weighted matrices between solve() calls.
+   */
+  std::size_t _getVCSErrVersion() const;
+  /**
+   * Visible cross section errors changed by the last version increment:
+   * (index, previous error) pairs. The list is valid only if the last
+   * change kept the points and the uncorrelated errors mode, so that
+   * the weight matrix changed on its diagonal only.
+   * @see _isLastVCSErrUpdateDiagonal
+   */
+  const std::vector<std::pair<std::size_t, double>>& _getLastVCSErrChanges() const;
+  /**
+   * Returns true if the last version increment changed diagonal
+   * weights of the same points only
+   */
+  bool _isLastVCSErrUpdateDiagonal() const;
   /**
    * Initialize visible cross section data
    * @param vcsGraph a visible cross section in a form of TGraphErrors
    */
   void setupVCS(TGraphErrors* vcsGraph);
+  /**
+   * Initialize visible cross section data
+   * @param n a number of points
+   * @param energy a center-of-mass energy array
+   * @param energyErr a center-of-mass energy error array
+   * @param vcs a visible cross section array
+   * @param vcsErr a visible cross section error array
+   */
+  void setupVCS(std::size_t n,
+                const double* energy, const double* energyErr,
+                const double* vcs, const double* vcsErr);
   /**
    * Initialize a detection efficiency
    */
   void _setupEfficiency() noexcept(false);
+  /**
+   * Read a visible cross section and a detection efficiency from
+   * a binary columnar (.isrbin) file
+   * @param inputPath a path to the binary columnar file
+   * @param inputOpts an input options
+   */
+  void _readColumnar(const std::string& inputPath,
+                     const InputOptions& inputOpts);
+  /**
+   * Set a visible cross section covariance matrix that is stored in
+   * the order of input points
+   * @param energy center-of-mass energies in the order of input points
+   * @param covMatrix a covariance matrix
+   */
+  void _setupVCSCovMatrix(const double* energy, const Eigen::MatrixXd& covMatrix);
+  /**
+   * Insert a visible cross section point keeping ascending order of
+   * center-of-mass energy. In the full covariance matrix mode the new
+   * point is uncorrelated with the others.
+   * @param energy a center-of-mass energy
+   * @param energyErr a center-of-mass energy error
+   * @param vcs a visible cross section
+   * @param vcsErr a visible cross section error
+   * @return an index of the inserted point
+   */
+  std::size_t _insertPoint(double energy, double energyErr,
+                           double vcs, double vcsErr) noexcept(false);
+  /**
+   * Remove a visible cross section point
+   * @param index an index of the point
+   */
+  void _erasePoint(std::size_t index) noexcept(false);
 
  private:
   /**
@@ -258,6 +380,30 @@ class BaseISRSolver {
    * numerical solution (Born cross section)
    */
   Eigen::VectorXd _bornCS;
+  /**
+   * full visible cross section covariance matrix mode
+   */
+  bool _isVCSCovMatrixFull;
+  /**
+   * full visible cross section covariance matrix
+   */
+  Eigen::MatrixXd _vcsCovMatrix;
+  /**
+   * Cholesky decomposition of the visible cross section covariance matrix
+   */
+  Eigen::LLT<Eigen::MatrixXd> _vcsCovLLT;
+  /**
+   * visible cross section error version
+   */
+  std::size_t _vcsErrVersion;
+  /**
+   * visible cross section errors changed by the last version increment
+   */
+  std::vector<std::pair<std::size_t, double>> _lastVCSErrChanges;
+  /**
+   * the last version increment changed diagonal weights only
+   */
+  bool _lastVCSErrUpdateDiagonal;
   friend double* extractECMPointer(BaseISRSolver*);
   friend double* extractECMErrPointer(BaseISRSolver*);
   friend double* extractVCSPointer(BaseISRSolver*);
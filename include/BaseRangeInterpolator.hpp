@@ -101,11 +101,13 @@ class BaseRangeInterpolator {
    * @param energyIndex a center-of-mass energy index
    * @param csIndex a cross section point index
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error (if not nullptr)
    */
   virtual double evalKuraevFadinBasisIntegral(
       int energyIndex,
       int csIndex,
-      const std::function<double(double, double)>& efficiency) const = 0;
+      const std::function<double(double, double)>& efficiency,
+      double* error = nullptr) const = 0;
   virtual double evalBasisSConvolution(
       int csIndex,
       const std::function<double(double)>& convKernel) const = 0;
@@ -52,11 +52,13 @@ class CSplineRangeInterpolator : public BaseRangeInterpolator {
    * @param energyIndex a center-of-mass energy index
    * @param csIndex a cross section point index
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error (if not nullptr)
    */
   double evalKuraevFadinBasisIntegral(
       int energyIndex,
       int csIndex,
-      const std::function<double(double, double)>& efficiency) const override final;
+      const std::function<double(double, double)>& efficiency,
+      double* error = nullptr) const override final;
   virtual double evalBasisSConvolution(
       int csIndex,
       const std::function<double(double)>& convKernel) const override final;
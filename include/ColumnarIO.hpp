@@ -0,0 +1,189 @@
+#ifndef _COLUMNAR_IO_HPP_
+#define _COLUMNAR_IO_HPP_
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+/**
+ * Binary columnar format (.isrbin).
+ *
+ * File layout (native little-endian byte order):
+ * - 64-byte header: magic "ISRBIN\0\0", uint32 version, uint32 number of entries
+ * - 64-byte entry records: char[40] name, uint64 offset, uint64 rows, uint64 cols
+ * - float64 data of each entry in column-major order, 64-byte aligned
+ *
+ * A graph (TGraphErrors analogue) is an entry with 4 columns:
+ * x, x error, y, y error. A detection efficiency "eff" is a matrix entry
+ * of efficiencies in (x, energy) bins with bin edges in "eff_energyEdges"
+ * and, for a 2D efficiency, "eff_xEdges". From Python an entry can be mapped with
+ * numpy.memmap(path, dtype='<f8', mode='r', offset=offset,
+ * shape=(rows, cols), order='F').
+ */
+
+/**
+ * The exception that is thrown when a file is not a valid binary columnar file
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Wrong binary columnar file.\n";
+  }
+} ColumnarFormatException;
+
+/**
+ * The exception that is thrown when a binary columnar file entry is not found
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Entry is not found in binary columnar file.\n";
+  }
+} ColumnarEntryException;
+
+/**
+ * The exception that is thrown when a binary columnar file can not be written
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Binary columnar file can not be written.\n";
+  }
+} ColumnarWriteException;
+
+/**
+ * Header of a binary columnar file
+ */
+typedef struct {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t nEntries;
+  std::uint64_t reserved[6];
+} ColumnarHeader;
+
+/**
+ * Entry record of a binary columnar file
+ */
+typedef struct {
+  char name[40];
+  std::uint64_t offset;
+  std::uint64_t rows;
+  std::uint64_t cols;
+} ColumnarEntry;
+
+/**
+ * Returns true if a path has the binary columnar file extension (.isrbin)
+ */
+bool isColumnarPath(const std::string& path);
+
+/**
+ * Writer of binary columnar files. Entries keep pointers to the data,
+ * so the data must be alive until write() is called.
+ */
+class ColumnarWriter {
+ public:
+  ColumnarWriter() = default;
+  /**
+   * Add a matrix entry
+   * @param name an entry name
+   * @param matrix a matrix
+   */
+  void addMatrix(const std::string& name, const Eigen::MatrixXd& matrix);
+  /**
+   * Add a vector entry
+   * @param name an entry name
+   * @param vector a vector
+   */
+  void addVector(const std::string& name, const Eigen::VectorXd& vector);
+  /**
+   * Add an entry from separate columns
+   * @param name an entry name
+   * @param rows a number of rows
+   * @param columns pointers to columns (nullptr means a zero column)
+   */
+  void addColumns(const std::string& name, std::size_t rows,
+                  const std::vector<const double*>& columns);
+  /**
+   * Add a graph entry (x, x error, y, y error)
+   * @param name an entry name
+   * @param n a number of points
+   * @param x x values
+   * @param ex x errors (may be nullptr)
+   * @param y y values
+   * @param ey y errors (may be nullptr)
+   */
+  void addGraph(const std::string& name, std::size_t n,
+                const double* x, const double* ex,
+                const double* y, const double* ey);
+  /**
+   * Write entries to a file
+   * @param path a path to the output file
+   * @throw ColumnarWriteException if the file can not be opened or written
+   */
+  void write(const std::string& path) const;
+
+ private:
+  typedef struct {
+    std::string name;
+    std::size_t rows;
+    std::vector<const double*> columns;
+  } Entry;
+  std::vector<Entry> _entries;
+};
+
+/**
+ * Read-only memory-mapped binary columnar file
+ */
+class ColumnarFile {
+ public:
+  /**
+   * Constructor
+   * @param path a path to the binary columnar file
+   */
+  explicit ColumnarFile(const std::string& path);
+  ColumnarFile(const ColumnarFile&) = delete;
+  ColumnarFile& operator=(const ColumnarFile&) = delete;
+  /**
+   * Destructor
+   */
+  ~ColumnarFile();
+  /**
+   * Returns true if the file contains an entry
+   * @param name an entry name
+   */
+  bool contains(const std::string& name) const;
+  /**
+   * Entry in a form of matrix (no copy)
+   * @param name an entry name
+   */
+  Eigen::Map<const Eigen::MatrixXd> matrix(const std::string& name) const;
+  /**
+   * Entry column (no copy)
+   * @param name an entry name
+   * @param col a column index
+   */
+  Eigen::Map<const Eigen::VectorXd> column(const std::string& name,
+                                           std::size_t col = 0) const;
+  /**
+   * Entry names
+   */
+  std::vector<std::string> names() const;
+
+ private:
+  const ColumnarEntry& _entry(const std::string& name) const;
+  void* _data;
+  std::size_t _size;
+  std::map<std::string, const ColumnarEntry*> _entries;
+};
+
+/**
+ * Detection efficiency stored in a binary columnar file.
+ * The table is copied, so the function does not depend on the file lifetime.
+ * @param file a binary columnar file
+ * @param name an efficiency entry name
+ * @return efficiency(x, energy), which is zero outside the table
+ */
+std::function<double(double, double)> columnarEfficiency(const ColumnarFile& file,
+                                                         const std::string& name);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _ENERGY_GRID_HPP_
+#define _ENERGY_GRID_HPP_
+#include <functional>
+#include <vector>
+
+/**
+ * Adaptive center-of-mass energy grid. Starting from a uniform grid,
+ * intervals are bisected while the linear interpolation error at
+ * the interval midpoint exceeds tolerance * max|fcn|, so points are
+ * concentrated where the function has high curvature (narrow resonances)
+ * and flat regions keep the initial spacing.
+ * @param emin a minimum energy
+ * @param emax a maximum energy
+ * @param nInitial a number of points of the initial uniform grid (at least 2)
+ * @param tolerance a relative interpolation tolerance
+ * @param maxPoints a maximum number of grid points
+ * @param fcn a function that fills values at a set of energies
+ * (called once per refinement pass)
+ * @return grid energies in ascending order
+ */
+std::vector<double> adaptiveEnergyGrid(
+    double emin, double emax,
+    std::size_t nInitial,
+    double tolerance,
+    std::size_t maxPoints,
+    const std::function<void(const std::vector<double>&, std::vector<double>*)>& fcn);
+
+#endif
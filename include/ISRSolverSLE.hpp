@@ -8,10 +8,29 @@
 
 using json = nlohmann::json;
 
+class ColumnarWriter;
 class ISRSolverSLE;
 double* extractIntOpMatrix(ISRSolverSLE*);
 double* extractBCSCovMatrix(ISRSolverSLE*);
 
+/**
+ * Per-cell cost of the integral operator matrix evaluation
+ */
+typedef struct {
+  /**
+   * Number of integrand evaluations
+   */
+  Eigen::MatrixXd evaluations;
+  /**
+   * Number of adaptive integration subintervals
+   */
+  Eigen::MatrixXd intervals;
+  /**
+   * Wall time (seconds)
+   */
+  Eigen::MatrixXd seconds;
+} IntegralOperatorCost;
+
 /**
  * Solver that solving integral equation using the naive method (without
  regularization). In this case the integral equation is reduced to a system of
@@ -71,6 +90,12 @@ class ISRSolverSLE : public BaseISRSolver {
    (Born cross section)
    */
   const Eigen::MatrixXd& getBornCSCovMatrix() const;
+  /**
+   * This method returns inverse covariance matrix of numerical solution
+   (Born cross section). The inverse is evaluated on first access after
+   the covariance matrix is changed.
+   */
+  const Eigen::MatrixXd& getBornCSInvCovMatrix() const;
   double sConvolution(const std::function<double(double)>&) const;
   double sConvolution(const std::function<double(double)>&,
                       double, double) const;
@@ -124,6 +149,96 @@ class ISRSolverSLE : public BaseISRSolver {
    * This method prints condition number of (non regularized) integral operator matrix
    */
   void printConditionNumber() const;
+  /**
+   * Enable recording of per-cell evaluation cost of the integral
+   operator matrix
+   */
+  void enableCostRecording();
+  /**
+   * Disable recording of per-cell evaluation cost of the integral
+   operator matrix
+   */
+  void disableCostRecording();
+  /**
+   * Returns true if per-cell cost recording is enabled
+   */
+  bool isCostRecordingEnabled() const;
+  /**
+   * Per-cell cost of the last integral operator matrix evaluation
+   (empty if cost recording was disabled)
+   */
+  const IntegralOperatorCost& getIntegralOperatorCost() const;
+  /**
+   * Enable error-controlled assembly of the integral operator matrix.
+   The cells of row i are integrated with the relative tolerance
+   precision * vcsErr(i) / |vcs(i)| (clamped to [1e-12, 1e-3]), so that
+   the integration error of the row stays well below the visible cross
+   section error instead of being driven to 1e-12.
+   * @param precision a target operator error in units of the visible
+   cross section errors
+   */
+  void enableErrorControlledAssembly(double precision = 0.1);
+  /**
+   * Disable error-controlled assembly (every cell starts from the
+   default integration tolerance)
+   */
+  void disableErrorControlledAssembly();
+  /**
+   * Returns true if error-controlled assembly is enabled
+   */
+  bool isErrorControlledAssemblyEnabled() const;
+  /**
+   * Absolute integration error estimates of the integral operator matrix
+   cells (including the energy spread if enabled). The matrix is empty if
+   error-controlled assembly is disabled.
+   */
+  const Eigen::MatrixXd& getIntegralOperatorErrorMatrix() const;
+  /**
+   * This method evaluates the achieved integral operator error bound:
+   max_i sum_j |dA_ij| |bcs_j| / vcsErr_i, where dA is the error matrix
+   and bcs is the current numerical solution
+   */
+  double evalIntegralOperatorErrorBound() const;
+  /**
+   * This method prints the achieved integral operator error bound
+   */
+  void printIntegralOperatorErrorBound() const;
+  /**
+   * Keep the kernel and the energy spread matrices, so that addPoint and
+   removePoint update a prepared integral operator matrix instead of
+   reassembling it on the next solve()
+   */
+  void enableIncrementalUpdates();
+  /**
+   * Release the kernel and the energy spread matrices (addPoint and
+   removePoint invalidate the integral operator matrix)
+   */
+  void disableIncrementalUpdates();
+  /**
+   * Returns true if incremental updates are enabled
+   */
+  bool isIncrementalUpdatesEnabled() const;
+  /**
+   * Add a visible cross section point (for example, while a scan is
+   still being taken). The interpolation settings are extended to the
+   new point. If incremental updates are enabled and the integral operator
+   matrix is prepared, only the row of the new point and the columns of
+   the basis functions that depend on it are evaluated.
+   * @param energy a center-of-mass energy
+   * @param energyErr a center-of-mass energy error
+   * @param vcs a visible cross section
+   * @param vcsErr a visible cross section error
+   * @return an index of the new point
+   */
+  std::size_t addPoint(double energy, double energyErr,
+                       double vcs, double vcsErr);
+  /**
+   * Remove a visible cross section point. If incremental updates are
+   enabled and the integral operator matrix is prepared, only the columns
+   of the basis functions that depend on the removed point are evaluated.
+   * @param index an index of the point
+   */
+  void removePoint(std::size_t index);
 
  protected:
   /**
@@ -131,7 +246,8 @@ class ISRSolverSLE : public BaseISRSolver {
    */
   Eigen::MatrixXd& _getIntegralOperatorMatrix();
   /**
-   * Covariance matrix non const getter
+   * Covariance matrix non const getter (invalidates the cached inverse
+   covariance matrix)
    */
   Eigen::MatrixXd& _getBornCSCovMatrix();
   /**
@@ -151,6 +267,77 @@ class ISRSolverSLE : public BaseISRSolver {
    solution (Born cross section) in a form of TF1
    */
   TF1* _createInterpFunction() const;
+  /**
+   * This method computes integral operator matrix and records
+   per-cell integration cost
+   */
+  void _evalEqMatrixRecordingCost();
+  /**
+   * This method evaluates integral operator matrix element
+   and stores its integration error estimate (if error-controlled
+   assembly is enabled)
+   * @param i a row (center-of-mass energy) index
+   * @param j a column (cross section point) index
+   */
+  double _evalEqMatrixElement(std::size_t i, std::size_t j);
+  /**
+   * Initial relative integration tolerance of the integral operator
+   matrix row
+   * @param i a row (center-of-mass energy) index
+   */
+  double _assemblyTolerance(std::size_t i) const;
+  /**
+   * This method evaluates center-of-mass energy spread matrix element
+   * @param i a row (center-of-mass energy) index
+   * @param j a column (cross section point) index
+   */
+  double _energySpreadMatrixElement(std::size_t i, std::size_t j) const;
+  /**
+   * This method evaluates integral operator matrix and its errors from
+   the kernel and the energy spread matrices, the kernel and the energy
+   spread matrices are released if incremental updates are disabled
+   */
+  void _applyEnergySpread();
+  /**
+   * This method updates prepared operators after a point is inserted or
+   removed (the data and the interpolator are already updated). Derived
+   solvers extend it to update their own operators and invalidate
+   decompositions.
+   * @param index an index of the inserted or removed point
+   * @param inserted true if the point is inserted
+   * @param columns indices of the basis functions that depend on the point
+   */
+  virtual void _updateOperators(std::size_t index, bool inserted,
+                                const std::vector<int>& columns);
+  /**
+   * This method updates the covariance matrix of the numerical solution
+   (and the inverse covariance matrix if it is cached) after visible cross
+   section errors are changed at a few points. The weight matrix is
+   diagonal, so each changed point is a rank-1 (Sherman-Morrison) update
+   that costs O(N^2) instead of O(N^3) re-inversion.
+   * @return false if the update is not applicable (the matrix is not
+   prepared, the change is not diagonal, too many points are changed,
+   N rank-1 updates are already accumulated or the update is
+   ill-conditioned), the matrix must be re-evaluated then
+   */
+  bool _updateBornCSCovMatrixLowRank();
+  /**
+   * This method writes per-cell integration errors (if error-controlled
+   assembly is enabled) and cost matrices (if recorded) to the current
+   ROOT directory
+   */
+  void _writeIntegralOperatorCost() const;
+  /**
+   * This method adds the results to a binary columnar file writer
+   * (the interpolation function is not stored)
+   * @param writer a binary columnar file writer
+   * @param outputOpts an output options
+   * @param bcsErr a numerical solution error, which must be alive
+   until the file is written
+   */
+  void _addColumnarEntries(ColumnarWriter* writer,
+                           const OutputOptions& outputOpts,
+                           const Eigen::VectorXd& bcsErr) const;
   /**
    * Numerical solution (Born cross section) error const getter
    */
@@ -166,6 +353,46 @@ class ISRSolverSLE : public BaseISRSolver {
   bool _isEqMatrixPrepared;
 
  private:
+  /**
+   * A boolean flag that is true when per-cell cost recording is enabled
+   */
+  bool _isCostRecordingEnabled;
+  /**
+   * Per-cell cost of the integral operator matrix
+   */
+  IntegralOperatorCost _integralOperatorCost;
+  /**
+   * A boolean flag that is true when error-controlled assembly is enabled
+   */
+  bool _isErrorControlledAssemblyEnabled;
+  /**
+   * Target operator error in units of the visible cross section errors
+   */
+  double _assemblyPrecision;
+  /**
+   * Integration error estimates of the integral operator matrix cells
+   (empty if error-controlled assembly is disabled)
+   */
+  Eigen::MatrixXd _integralOperatorErrors;
+  /**
+   * A boolean flag that is true when incremental updates are enabled
+   */
+  bool _isIncrementalUpdatesEnabled;
+  /**
+   * Kuraev-Fadin kernel part of the integral operator matrix
+   (without the energy spread, empty if incremental updates are disabled)
+   */
+  Eigen::MatrixXd _kernelMatrix;
+  /**
+   * Integration error estimates of the kernel matrix cells (empty if
+   error-controlled assembly is disabled)
+   */
+  Eigen::MatrixXd _kernelErrors;
+  /**
+   * Center-of-mass energy spread matrix (empty if the energy spread
+   or incremental updates are disabled)
+   */
+  Eigen::MatrixXd _spreadMatrix;
   /**
    * Integral operator matrix
    */
@@ -174,6 +401,38 @@ class ISRSolverSLE : public BaseISRSolver {
    * Covariance matrix of the numerical solution
    */
   Eigen::MatrixXd _covMatrixBornCS;
+  /**
+   * Cached inverse covariance matrix of the numerical solution
+   */
+  mutable Eigen::MatrixXd _invCovMatrixBornCS;
+  /**
+   * A boolean flag that is true when the cached inverse covariance
+   matrix corresponds to the current covariance matrix
+   */
+  mutable bool _isInvCovMatrixBornCSPrepared;
+  /**
+   * Pseudo-inverse of the integral operator matrix
+   */
+  Eigen::MatrixXd _intOpPseudoInverse;
+  /**
+   * A boolean flag that is true when the pseudo-inverse corresponds
+   to the current integral operator matrix
+   */
+  bool _isIntOpPseudoInversePrepared;
+  /**
+   * A boolean flag that is true when the covariance matrix is evaluated
+   by ISRSolverSLE::solve() for the current integral operator matrix
+   */
+  bool _isCovMatrixBornCSPrepared;
+  /**
+   * Version of visible cross section errors used in the covariance matrix
+   */
+  std::size_t _covMatrixVCSErrVersion;
+  /**
+   * Number of rank-1 updates applied to the covariance matrix since
+   it was evaluated from scratch
+   */
+  std::size_t _nCovMatrixLowRankUpdates;
   /**
    * Dot product weights
    */
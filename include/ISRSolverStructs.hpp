@@ -64,8 +64,38 @@ typedef struct {
    * A threshold energy
    */
   double thresholdEnergy;
+  /**
+   * A name of a full visible cross section covariance matrix (TMatrixD),
+   * rows follow the order of the visible cross section points.
+   * Visible cross section errors are used if the name is empty.
+   */
+  std::string vcsCovMatrixName;
 } InputOptions;
 
+/**
+ * Products written by save() (bit flags)
+ */
+enum OutputProduct : unsigned {
+  OutputVisibleCS = 1u << 0,
+  OutputBornCS = 1u << 1,
+  OutputIntegralOperatorMatrix = 1u << 2,
+  OutputBornCSCovMatrix = 1u << 3,
+  OutputBornCSInvCovMatrix = 1u << 4,
+  OutputInterpFunction = 1u << 5,
+  OutputRadiativeCorrection = 1u << 6,
+  OutputIntegralOperatorCost = 1u << 7,
+  OutputAllProducts = ~0u
+};
+
+/**
+ * The exception that is thrown when an output product name is unknown
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Unknown output product.\n";
+  }
+} OutputProductException;
+
 /**
  * Output options
  */
@@ -78,6 +108,12 @@ typedef struct {
    * A name a Born cross section object (TGraphErrors)
    */
   std::string bornCSGraphName;
+  /**
+   * Products to write (OutputProduct bit flags). Derived products
+   * (inverse covariance matrix, interpolation function) are computed
+   * only if requested.
+   */
+  unsigned products = OutputAllProducts;
 } OutputOptions;
 
 /**
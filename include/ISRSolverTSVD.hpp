@@ -81,6 +81,16 @@ class ISRSolverTSVD : public ISRSolverSLE {
    is enabled
    */
   void disableKeepOne();
+
+ protected:
+  /**
+   * This method updates the integral operator matrix after a point is
+   inserted or removed and invalidates the SVD
+   * @see ISRSolverSLE::_updateOperators
+   */
+  virtual void _updateOperators(std::size_t index, bool inserted,
+                                const std::vector<int>& columns) override;
+
  private:
   /**
    * Upper TSVD index
@@ -98,6 +108,28 @@ class ISRSolverTSVD : public ISRSolverSLE {
   Eigen::MatrixXd _mU;
   Eigen::MatrixXd _mV;
   Eigen::VectorXd _mSing;
+  /**
+   * A boolean flag that is true when the SVD corresponds to the current
+   integral operator matrix
+   */
+  bool _isSVDPrepared;
+  /**
+   * A boolean flag that is true when the covariance matrix corresponds
+   to the current SVD harmonics and visible cross section errors
+   */
+  bool _isTSVDCovMatrixPrepared;
+  /**
+   * First SVD harmonic used in the covariance matrix
+   */
+  int _covFirstIndex;
+  /**
+   * Number of SVD harmonics used in the covariance matrix
+   */
+  int _covNHarmonics;
+  /**
+   * Version of visible cross section errors used in the covariance matrix
+   */
+  std::size_t _covVCSErrVersion;
 };
 
 #endif
@@ -124,10 +124,40 @@ class ISRSolverTikhonov : public ISRSolverSLE {
    * This method calculates auxiliary matrices arising from regularization
    */
   void _evalProblemMatrices();
+  /**
+   * This method calculates matrices that do not depend on the
+   regularization parameter: the regularizator matrix F, the whitened
+   integral operator matrix, A^T C^-1 A and F^-1 A^T C^-1 A
+   */
+  void _evalWeightedMatrices();
+  /**
+   * This method updates the weighted matrices, the gain matrix mG and
+   the covariance matrix after visible cross section errors are changed
+   at a few points. Each changed point is a rank-1 update of
+   A^T C^-1 A (Sherman-Morrison), which costs O(N^2).
+   * @return false if the update is not applicable (including the case
+   of N rank-1 updates already accumulated), the matrices must be
+   re-evaluated then
+   */
+  bool _updateProblemMatricesLowRank();
+  /**
+   * LU decomposition of F^-1 A^T C^-1 A + lambda I, which is evaluated
+   on demand for the prepared regularization parameter
+   */
+  const Eigen::FullPivLU<Eigen::MatrixXd>& _getLuL() const;
   /**
    * This method evaluates derivative operator matrix
    */
   void _evalInterpPointWiseDerivativeProjector();
+  /**
+   * This method updates the integral operator matrix, the dot product
+   weights and the derivative operator matrix after a point is inserted
+   or removed: the row of the new point and the columns of the basis
+   functions that depend on the point are evaluated
+   * @see ISRSolverSLE::_updateOperators
+   */
+  virtual void _updateOperators(std::size_t index, bool inserted,
+                                const std::vector<int>& columns) override;
 
  private:
   /**
@@ -147,9 +177,73 @@ class ISRSolverTikhonov : public ISRSolverSLE {
    * !!! TO DO
    */
   Eigen::MatrixXd _mF;
-  Eigen::MatrixXd _mL;
-  Eigen::FullPivLU<Eigen::MatrixXd> _luT;
-  Eigen::FullPivLU<Eigen::MatrixXd> _luL;
+  /**
+   * Integral operator matrix multiplied by L^-1 (whitened)
+   */
+  Eigen::MatrixXd _mWA;
+  /**
+   * F^-1 A^T C^-1 A + lambda I
+   */
+  mutable Eigen::MatrixXd _mL;
+  /**
+   * Workspace: A^T C^-1 A + lambda F
+   */
+  Eigen::MatrixXd _mT;
+  /**
+   * Workspace: T^-1 (L^-1 A)^T
+   */
+  Eigen::MatrixXd _mG;
+  /**
+   * Workspace: L^-1 vcs
+   */
+  Eigen::VectorXd _whitenedVCS;
+  /**
+   * LU decomposition of T, which is symmetric positive definite
+   for a positive regularization parameter
+   */
+  Eigen::PartialPivLU<Eigen::MatrixXd> _luT;
+  mutable Eigen::FullPivLU<Eigen::MatrixXd> _luL;
+  /**
+   * A^T C^-1 A
+   */
+  Eigen::MatrixXd _mAtWA;
+  /**
+   * F^-1 A^T C^-1 A
+   */
+  Eigen::MatrixXd _mFInvAtWA;
+  /**
+   * A boolean flag that is true when the matrices that do not depend
+   on the regularization parameter are prepared
+   */
+  bool _areWeightedMatricesPrepared;
+  /**
+   * Version of visible cross section errors used in the weighted matrices
+   */
+  std::size_t _weightedMatricesVCSErrVersion;
+  /**
+   * A boolean flag that is true when the factorizations, the gain matrix
+   mG and the covariance matrix correspond to the weighted matrices
+   and the regularization parameter _problemMatricesLambda
+   */
+  bool _areProblemMatricesPrepared;
+  /**
+   * Regularization parameter of the prepared factorizations
+   */
+  double _problemMatricesLambda;
+  /**
+   * A boolean flag that is true when _luL corresponds to the prepared
+   problem matrices
+   */
+  mutable bool _isLuLPrepared;
+  /**
+   * LU decomposition of the regularizator matrix F
+   */
+  Eigen::PartialPivLU<Eigen::MatrixXd> _luF;
+  /**
+   * Number of rank-1 updates applied since the weighted matrices
+   were evaluated from scratch
+   */
+  std::size_t _nLowRankUpdates;
 };
 
 #endif
@@ -3,6 +3,8 @@
 #include <vector>
 #include <functional>
 #include <Minuit2/FCNBase.h>
+#include <Minuit2/FCNGradientBase.h>
+#include "RadiatorOperator.hpp"
 
 class ISRSolverVCSFitFunction : public ROOT::Minuit2::FCNBase {
  public:
@@ -19,16 +21,96 @@ class ISRSolverVCSFitFunction : public ROOT::Minuit2::FCNBase {
   void setErrorDef(double def);
   void enableEnergySpread();
   void disableEnergySpread();
+  /**
+   * Set a number of threads used to evaluate chi-square
+   * (0 means hardware concurrency). The fit function and the efficiency
+   * are called from several threads if nThreads != 1, so they must be
+   * thread-safe (a shared TF1 or a Python callable is not).
+   */
+  void setNumberOfThreads(std::size_t nThreads);
+  /**
+   * Number of threads used to evaluate chi-square
+   */
+  std::size_t getNumberOfThreads() const;
  private:
   bool _energySpread;
-  double _threshold;
+  std::size_t _nThreads;
   double _errorDef;
   std::function<double(double, const std::vector<double>&)> _fcn;
-  std::function<double(double, double)> _eff;
+  /**
+   * Radiator operator (threshold and detection efficiency)
+   */
+  RadiatorOperator _radiator;
   std::vector<double> _ecm;
   std::vector<double> _ecmErr;
   std::vector<double> _vcs;
   std::vector<double> _vcsErr;
+  friend class ISRSolverVCSFitFunctionGrad;
+};
+
+/**
+ * Visible cross section fit function that also provides analytic
+ * parameter gradients. The chi-square value and its gradient use the same
+ * fixed-node radiator operator rules that are prepared once, so that
+ * the gradient is the exact derivative of the minimized function, and
+ * the model and all parameter derivatives are evaluated in one pass over
+ * the rule nodes. The value may differ slightly from the adaptive
+ * quadrature of ISRSolverVCSFitFunction.
+ */
+class ISRSolverVCSFitFunctionGrad : public ROOT::Minuit2::FCNGradientBase {
+ public:
+  /**
+   * Constructor
+   * @param n a number of points
+   * @param threshold a threshold energy
+   * @param energy a center-of-mass energy array
+   * @param vis_cs a visible cross section array
+   * @param energy_err a center-of-mass energy error array (may be nullptr)
+   * @param vis_cs_err a visible cross section error array
+   * @param fit_fcn a Born cross section model
+   * @param grad_fcn a function that fills derivatives of the Born cross
+   * section model with respect to the parameters
+   * @param eff_fcn a detection efficiency
+   */
+  ISRSolverVCSFitFunctionGrad(
+      std::size_t n,
+      double threshold,
+      double* energy, double* vis_cs,
+      double* energy_err, double* vis_cs_err,
+      const std::function<double(double, const std::vector<double>&)>& fit_fcn,
+      const std::function<void(double, const std::vector<double>&,
+                               std::vector<double>&)>& grad_fcn,
+      const std::function<double(double, double)>& eff_fcn =
+      [](double, double) {return 1.;});
+  virtual ~ISRSolverVCSFitFunctionGrad();
+  virtual double Up() const override final;
+  virtual double operator()(const std::vector<double>&) const override final;
+  virtual std::vector<double> Gradient(const std::vector<double>&) const override final;
+  void setErrorDef(double def);
+  /**
+   * Set a number of threads (0 means hardware concurrency). The fit
+   * function and the gradient function must be thread-safe if
+   * nThreads != 1 (the efficiency is included in the rule weights).
+   * @see ISRSolverVCSFitFunction::setNumberOfThreads
+   */
+  void setNumberOfThreads(std::size_t nThreads);
+  std::size_t getNumberOfThreads() const;
+ private:
+  /**
+   * Visible cross section at the point i evaluated with the rules
+   * @param i a point index
+   * @param par fit parameters
+   * @param dvcs derivatives with respect to the parameters (not evaluated if nullptr)
+   */
+  double _evalVCS(std::size_t i, const std::vector<double>& par,
+                  std::vector<double>* dvcs) const;
+  ISRSolverVCSFitFunction _fitFunction;
+  std::function<void(double, const std::vector<double>&,
+                     std::vector<double>&)> _gradFcn;
+  /**
+   * Radiator operator with rules (energy spread included) for each point
+   */
+  RadiatorOperator _radiator;
 };
 
 #endif
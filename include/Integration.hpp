@@ -1,6 +1,48 @@
 #ifndef _INTEGRATION_HPP_
 #define _INTEGRATION_HPP_
+#include <cstddef>
 #include <functional>
+#include <vector>
+
+/**
+ * Integration statistics accumulated by the calling thread
+ */
+typedef struct {
+  /**
+   * Number of integrand evaluations
+   */
+  std::size_t evaluations;
+  /**
+   * Number of subintervals used by adaptive integration
+   */
+  std::size_t intervals;
+} IntegrationStats;
+
+/**
+ * Scoped initial relative tolerance of integrate(), integrateS() and
+ * integrateP() in the calling thread (1e-12 by default). The tolerance
+ * is escalated as usual if it can not be reached.
+ */
+class IntegrationToleranceScope {
+ public:
+  /**
+   * Constructor
+   * @param relerr an initial relative tolerance
+   */
+  explicit IntegrationToleranceScope(double relerr);
+  /**
+   * Destructor (restores the previous tolerance)
+   */
+  ~IntegrationToleranceScope();
+  IntegrationToleranceScope(const IntegrationToleranceScope&) = delete;
+  IntegrationToleranceScope& operator=(const IntegrationToleranceScope&) = delete;
+
+ private:
+  /**
+   * Previous tolerance
+   */
+  double _previous;
+};
 
 /**
  * Adaptive integration using GSL
@@ -18,6 +60,15 @@ double integrate(std::function<double(double)>& fcn, double a, double b, double&
  * @param error an integration absolute error
  */
 double integrateS(std::function<double(double)>& fcn, double a, double b, double& error);
+/**
+ * Adaptive integration with known breakpoints using GSL
+ * (singularities and peaks at the breakpoints are allowed)
+ * @param fcn an integrand
+ * @param points the lower limit, breakpoints in ascending order and the upper limit
+ * @param error an integration absolute error
+ */
+double integrateP(std::function<double(double)>& fcn, std::vector<double> points,
+                  double& error);
 /**
  * Gaussian convolution
  * @param energy a mean center-of-mass energy
@@ -25,5 +76,17 @@ double integrateS(std::function<double(double)>& fcn, double a, double b, double
  * @param fcn an integrand
  */
 double gaussian_conv(double energy, double sigma2, std::function<double(double)>& fcn);
+/**
+ * Initial relative tolerance of adaptive integration in the calling thread
+ */
+double integrationTolerance();
+/**
+ * Integration statistics of the calling thread since the last reset
+ */
+IntegrationStats integrationStats();
+/**
+ * Reset integration statistics of the calling thread
+ */
+void resetIntegrationStats();
 
 #endif
@@ -77,11 +77,13 @@ class Interpolator {
    * @param csIndex an index of cross-section point that corresponds
    * to considered basis interpolation function
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error (if not nullptr)
    */
   double evalKuraevFadinBasisIntegral(
       int energyIndex,
       int csIndex,
-      const std::function<double(double, double)>& efficiency) const;
+      const std::function<double(double, double)>& efficiency,
+      double* error = nullptr) const;
   double evalBasisSConvolution(
       int csIndex,
       const std::function<double(double)>& convKernel) const;
@@ -159,6 +161,42 @@ class Interpolator {
    */
   static std::vector<std::tuple<bool, int, int>>
   defaultInterpRangeSettings(int n);
+  /**
+   * Interpolation settings sorted by the first segment index
+   */
+  const std::vector<std::tuple<bool, int, int>>& getRangeInterpSettings() const;
+  /**
+   * Indices of basis interpolation functions that depend on the
+   * center-of-mass energy point csIndex: the neighbouring points
+   * of piecewise linear ranges and all points of cubic spline ranges
+   * (the splines are built on all center-of-mass energies)
+   * @param csIndex an index of a cross section point
+   */
+  std::vector<int> getDependentCSIndices(int csIndex) const;
+  /**
+   * Interpolation settings after a point insertion: the segment
+   * that contains the new point is split, the range that contains
+   * this segment (or the last range) is extended
+   * @param sortedInterpRangeSettings an interpolation settings
+   * @param csIndex an index of the new point
+   * @param n a number of points before the insertion
+   */
+  static std::vector<std::tuple<bool, int, int>>
+  insertPointRangeInterpSettings(
+      const std::vector<std::tuple<bool, int, int>>& sortedInterpRangeSettings,
+      int csIndex, int n);
+  /**
+   * Interpolation settings after a point removal: the segments on
+   * both sides of the point are merged, ranges left without
+   * segments are dropped
+   * @param sortedInterpRangeSettings an interpolation settings
+   * @param csIndex an index of the removed point
+   * @param n a number of points before the removal
+   */
+  static std::vector<std::tuple<bool, int, int>>
+  erasePointRangeInterpSettings(
+      const std::vector<std::tuple<bool, int, int>>& sortedInterpRangeSettings,
+      int csIndex, int n);
  private:
   /**
    * Check validity of range interpolation settings
@@ -169,6 +207,10 @@ class Interpolator {
       const std::vector<std::tuple<bool, int, int>>&
       sortedInterpRangeSettings,
       const Eigen::VectorXd& cmEnergies);
+  /**
+   * Interpolation settings sorted by the first segment index
+   */
+  std::vector<std::tuple<bool, int, int>> _rangeInterpSettings;
   /**
    * Interpolation settings
    */
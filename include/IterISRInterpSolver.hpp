@@ -1,5 +1,6 @@
 #ifndef _ITER_ISR_INTERP_SOLVER_HPP_
 #define _ITER_ISR_INTERP_SOLVER_HPP_
+#include <vector>
 #include "ISRSolverSLE.hpp"
 #include "Interpolator.hpp"
 
@@ -55,14 +56,44 @@ class IterISRInterpSolver : public ISRSolverSLE {
    */
   virtual void solve() override;
   /**
-   * Setter for a number of iterations
+   * Setter for a maximum number of iterations
    * @param nIter a number of iterations
    */
   void setNumOfIters(std::size_t nIter);
   /**
-   * Getter for a number of iterations
+   * Getter for a maximum number of iterations
    */
   std::size_t getNumOfIters() const;
+  /**
+   * Setter for a tolerance. Iterations stop when the maximum relative
+   change of the radiative correction is below the tolerance
+   (0 means that all iterations are performed).
+   * @param tolerance a tolerance
+   */
+  void setTolerance(double tolerance);
+  /**
+   * Getter for a tolerance
+   */
+  double getTolerance() const;
+  /**
+   * Setter for a depth of the Anderson acceleration of the fixed-point
+   iterations (0 means plain iterations)
+   * @param depth a number of previous iterations used by the acceleration
+   */
+  void setAndersonDepth(std::size_t depth);
+  /**
+   * Getter for a depth of the Anderson acceleration
+   */
+  std::size_t getAndersonDepth() const;
+  /**
+   * Number of iterations performed by the last solve() call
+   */
+  std::size_t getIterationCount() const;
+  /**
+   * Maximum relative change of the radiative correction at each
+   iteration of the last solve() call
+   */
+  const std::vector<double>& getResidualHistory() const;
   /**
    * Saving results
    * @param outputPath a path to the .root file where the results
@@ -79,10 +110,47 @@ class IterISRInterpSolver : public ISRSolverSLE {
    * Number of iterations
    */
   std::size_t _nIter;
+  /**
+   * Tolerance on the relative change of the radiative correction
+   */
+  double _tolerance;
+  /**
+   * Depth of the Anderson acceleration
+   */
+  std::size_t _andersonDepth;
+  /**
+   * Residuals of the last solve() call
+   */
+  std::vector<double> _residualHistory;
   /**
    * Radiative correction (delta)
    */
   Eigen::VectorXd _radcorr;
+  /**
+   * Workspace: visible cross section of the current iteration
+   */
+  Eigen::VectorXd _curVCS;
+  /**
+   * Workspace: fixed-point map value vcs / radcorr
+   */
+  Eigen::VectorXd _fixedPoint;
+  /**
+   * Anderson acceleration workspaces: differences of residuals and
+   fixed-point map values of the previous iterations
+   */
+  Eigen::MatrixXd _andersonDF;
+  Eigen::MatrixXd _andersonDG;
+  /**
+   * Anderson acceleration workspaces: residual and fixed-point map
+   value of the previous iteration
+   */
+  Eigen::VectorXd _prevResidual;
+  Eigen::VectorXd _prevFixedPoint;
+  /**
+   * Next iterate of the Anderson acceleration
+   * @param nCols a number of stored previous iterations
+   */
+  void _andersonStep(std::size_t nCols);
 };
 
 #endif
@@ -1,6 +1,43 @@
 #ifndef _KURAEV_FADIN_HPP_
 #define _KURAEV_FADIN_HPP_
 #include <functional>
+#include <vector>
+
+/**
+ * Fixed-node quadrature rule for the Kuraev-Fadin convolution at
+ * a given center-of-mass energy. The kernel and the detection efficiency
+ * are absorbed into the weights, so the convolution of any function
+ * fcn is approximated by sum_k weight[k] * fcn(energy[k]).
+ */
+typedef struct {
+  /**
+   * Momentum fractions of the nodes
+   */
+  std::vector<double> x;
+  /**
+   * Center-of-mass energies at which the kernel is evaluated
+   */
+  std::vector<double> ecm;
+  /**
+   * Energies at which a convoluted function is evaluated
+   */
+  std::vector<double> energy;
+  /**
+   * Quadrature weights
+   */
+  std::vector<double> weight;
+} KuraevFadinRule;
+
+/**
+ * Breakpoints x = 1 - (peak / energy)^2 of peaks of a convoluted function
+ * @param energy a center-of-mass energy
+ * @param min_x a lower integration limit
+ * @param max_x an upper integration limit
+ * @param peaks peak energies
+ * @return breakpoints inside (min_x, max_x) in ascending order
+ */
+std::vector<double> peakBreakpointsKuraevFadin(double energy, double min_x, double max_x,
+                                               const std::vector<double>& peaks);
 
 /**
  * Convolution of a function with the Kuraev-Fadin kernel function and a detection efficiency
@@ -9,13 +46,64 @@
  * @param min_x a lower integration limit
  * @param max_x an upper integration limut
  * @param efficiency a detection efficiency (default value = 1)
+ * @param peaks energies of narrow peaks of fcn, used as quadrature breakpoints
+ * @param error an estimate of the absolute integration error (if not nullptr)
  */
 double convolutionKuraevFadin(double energy,
                               const std::function<double(double)>& fcn,
                               double min_x,
                               double max_x,
                               const std::function<double(double, double)>& efficiency =
-                              [](double, double) {return 1.;});
+                              [](double, double) {return 1.;},
+                              const std::vector<double>& peaks = {},
+                              double* error = nullptr);
+
+/**
+ * Fixed-node quadrature rule for the Kuraev-Fadin convolution
+ * @param energy a center-of-mass energy
+ * @param min_x a lower integration limit
+ * @param max_x an upper integration limit
+ * @param efficiency a detection efficiency (default value = 1)
+ * @param nPanels a number of Gauss-Legendre panels above x = 4 m_e / E
+ * @param order a number of Gauss-Legendre nodes per panel
+ * @param peaks energies of narrow peaks of a convoluted function,
+ * used as extra panel boundaries above x = 4 m_e / E
+ */
+KuraevFadinRule ruleKuraevFadin(double energy,
+                                double min_x,
+                                double max_x,
+                                const std::function<double(double, double)>& efficiency =
+                                [](double, double) {return 1.;},
+                                std::size_t nPanels = 32,
+                                std::size_t order = 8,
+                                const std::vector<double>& peaks = {});
+
+/**
+ * Fixed-node quadrature rule for the Kuraev-Fadin convolution
+ * smeared by a Gaussian center-of-mass energy spread
+ * (the nodes of gaussian_conv are used)
+ * @param energy a mean center-of-mass energy
+ * @param sigma2 a square of center-of-mass energy spread (0 means no spread)
+ * @param threshold a threshold energy
+ * @param efficiency a detection efficiency (default value = 1)
+ * @param peaks energies of narrow peaks of a convoluted function
+ */
+KuraevFadinRule ruleKuraevFadinSpread(double energy,
+                                      double sigma2,
+                                      double threshold,
+                                      const std::function<double(double, double)>& efficiency =
+                                      [](double, double) {return 1.;},
+                                      const std::vector<double>& peaks = {});
+
+/**
+ * Append nodes of one rule to another rule
+ * @param rule a rule that is extended
+ * @param part a rule whose nodes are appended
+ * @param factor a factor applied to the weights of the appended nodes
+ */
+void appendKuraevFadinRule(KuraevFadinRule* rule,
+                           const KuraevFadinRule& part,
+                           double factor = 1.);
 
 /**
  * The Kuraev-Fadin kernel function.
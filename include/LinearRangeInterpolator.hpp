@@ -50,11 +50,13 @@ class LinearRangeInterpolator : public BaseRangeInterpolator {
    * @param energyIndex a center-of-mass energy index
    * @param csIndex a cross section point index
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error (if not nullptr)
    */
   double evalKuraevFadinBasisIntegral(
       int energyIndex,
       int csIndex,
-      const std::function<double(double, double)>& efficiency) const override final;
+      const std::function<double(double, double)>& efficiency,
+      double* error = nullptr) const override final;
   virtual double evalBasisSConvolution(
       int csIndex,
       const std::function<double(double)>& convKernel) const override final;
@@ -68,20 +70,24 @@ class LinearRangeInterpolator : public BaseRangeInterpolator {
    * @param energyIndex a center-of-mass energy index
    * @param csIndex a cross section point index
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error
    */
   double _evalKuraevFadinBasisIntegralFirstTriangle(
       int energyIndex, int csIndex,
-      const std::function<double(double, double)>& efficiency) const;
+      const std::function<double(double, double)>& efficiency,
+      double* error) const;
   /**
    * Evaluate Kuraev-Fadin convolution inside the second triangle
    with basis interpolation
    * @param energyIndex a center-of-mass energy index
    * @param csIndex a cross section point index
    * @param efficiency a detection efficiency
+   * @param error an estimate of the absolute integration error
    */
   double _evalKuraevFadinBasisIntegralSecondTriangle(
       int energyIndex, int csIndex,
-      const std::function<double(double, double)>& efficiency) const;
+      const std::function<double(double, double)>& efficiency,
+      double* error) const;
   double _evalBasisSConvolutionFirstTriangle(
       int csIndex,
       const std::function<double(double)>& convKernel) const;
@@ -0,0 +1,45 @@
+#ifndef _NO_MALLOC_CHECK_HPP_
+#define _NO_MALLOC_CHECK_HPP_
+#include <Eigen/Core>
+
+/**
+ * Debug check that solve() performs no Eigen heap allocation once
+ * the solver workspaces are sized. With EIGEN_RUNTIME_NO_MALLOC defined
+ * (ENABLE_NO_MALLOC_CHECK build option) Eigen asserts on any heap
+ * allocation inside an ISR_NO_MALLOC_SCOPE, otherwise the macro
+ * expands to nothing.
+ *
+ * Eigen keeps matrix product blocking buffers on the stack up to
+ * EIGEN_STACK_ALLOCATION_LIMIT, which covers problems with up to about
+ * 128 points. The allowed flag is process-wide, so the check is meant
+ * for single-threaded runs.
+ */
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+class NoMallocScope {
+ public:
+  /**
+   * Constructor
+   * @param enabled forbid heap allocations if true
+   */
+  explicit NoMallocScope(bool enabled) :
+      _wasAllowed(Eigen::internal::is_malloc_allowed()) {
+    if (enabled) {
+      Eigen::internal::set_is_malloc_allowed(false);
+    }
+  }
+  ~NoMallocScope() {
+    Eigen::internal::set_is_malloc_allowed(_wasAllowed);
+  }
+  NoMallocScope(const NoMallocScope&) = delete;
+  NoMallocScope& operator=(const NoMallocScope&) = delete;
+
+ private:
+  bool _wasAllowed;
+};
+
+#define ISR_NO_MALLOC_SCOPE(enabled) NoMallocScope _isrNoMallocScope(enabled)
+#else
+#define ISR_NO_MALLOC_SCOPE(enabled)
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+#include <cstddef>
+#include <functional>
+
+/**
+ * Number of hardware threads (at least 1)
+ */
+std::size_t hardwareConcurrency();
+/**
+ * Run fcn over the index range [0, n) split into contiguous chunks
+ * @param n a number of indices
+ * @param nThreads a number of worker threads (0 means hardware concurrency)
+ * @param fcn a callback that processes the chunk [first, last)
+ *
+ * Chunk boundaries depend only on n and nThreads, so callers that store
+ * per-index results and reduce them in index order get results that do
+ * not depend on thread scheduling. An exception thrown by any chunk is
+ * rethrown in the calling thread after all workers have joined.
+ */
+void parallelFor(std::size_t n, std::size_t nThreads,
+                 const std::function<void(std::size_t, std::size_t)>& fcn);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef _PROFILER_HPP_
+#define _PROFILER_HPP_
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+
+/**
+ * Accumulated wall time and number of calls of a profiled phase
+ */
+typedef struct {
+  /**
+   * Number of calls
+   */
+  std::size_t calls;
+  /**
+   * Total wall time (seconds)
+   */
+  double seconds;
+} ProfilerPhase;
+
+/**
+ * Process-wide collector of per-phase timers and counters.
+ * Instrumentation points use the ISR_PROFILE_* macros, which compile
+ * to nothing unless ISRSOLVER_ENABLE_PROFILING is defined.
+ */
+class Profiler {
+ public:
+  /**
+   * Profiler instance
+   */
+  static Profiler& instance();
+  /**
+   * Returns true if the library is built with profiling enabled
+   */
+  static bool isEnabled();
+  /**
+   * Add a wall time of one call of a phase
+   * @param phase a phase name
+   * @param seconds a wall time (seconds)
+   */
+  void addTime(const std::string& phase, double seconds);
+  /**
+   * Increment a counter
+   * @param counter a counter name
+   * @param value an increment
+   */
+  void addCount(const std::string& counter, std::size_t value = 1);
+  /**
+   * Keep the maximum value of a counter
+   * @param counter a counter name
+   * @param value a candidate value
+   */
+  void updateMax(const std::string& counter, std::size_t value);
+  /**
+   * Reset all timers and counters
+   */
+  void reset();
+  /**
+   * Report in a form of JSON object
+   */
+  nlohmann::json report() const;
+  /**
+   * Save report to a .json file
+   * @param path a path to the output file
+   */
+  void dump(const std::string& path) const;
+
+ private:
+  Profiler() = default;
+  mutable std::mutex _mutex;
+  std::map<std::string, ProfilerPhase> _phases;
+  std::map<std::string, std::size_t> _counters;
+};
+
+/**
+ * Timer that adds its lifetime to a profiled phase
+ */
+class ProfilerScopedTimer {
+ public:
+  explicit ProfilerScopedTimer(const char* phase);
+  ~ProfilerScopedTimer();
+  ProfilerScopedTimer(const ProfilerScopedTimer&) = delete;
+  ProfilerScopedTimer& operator=(const ProfilerScopedTimer&) = delete;
+
+ private:
+  const char* _phase;
+  std::chrono::steady_clock::time_point _start;
+};
+
+#define ISR_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ISR_PROFILE_CONCAT(a, b) ISR_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef ISRSOLVER_ENABLE_PROFILING
+#define ISR_PROFILE_SCOPE(phase) \
+  ProfilerScopedTimer ISR_PROFILE_CONCAT(_isrProfileTimer, __LINE__)(phase)
+#define ISR_PROFILE_COUNT(counter, value) \
+  Profiler::instance().addCount(counter, value)
+#define ISR_PROFILE_MAX(counter, value) \
+  Profiler::instance().updateMax(counter, value)
+#else
+#define ISR_PROFILE_SCOPE(phase)
+#define ISR_PROFILE_COUNT(counter, value)
+#define ISR_PROFILE_MAX(counter, value)
+#endif
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef _PY_BATCH_HPP_
+#define _PY_BATCH_HPP_
+#define PY_SSIZE_T_CLEAN
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Python.h>
+#include <numpy/arrayobject.h>
+#include "ISRSolverSLE.hpp"
+#include "ISRSolverTikhonov.hpp"
+#include "ISRSolverTSVD.hpp"
+#include "IterISRInterpSolver.hpp"
+#include "Parallel.hpp"
+#include "PyUtils.hpp"
+
+/**
+ * One dataset of a batch and its results
+ */
+typedef struct {
+  std::vector<double> energy;
+  std::vector<double> energyErr;
+  std::vector<double> vcs;
+  std::vector<double> vcsErr;
+  Eigen::VectorXd ecm;
+  Eigen::VectorXd bcs;
+  Eigen::MatrixXd bcsCovMatrix;
+} PyBatchDataset;
+
+/**
+ * Copy a 1D array-like object to a vector
+ * @return false if a Python exception is set
+ */
+static bool pyBatchCopyArray(PyObject* obj, std::vector<double>* values) {
+  PyArrayObject* array = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(obj, NPY_FLOAT64, NPY_ARRAY_IN_ARRAY));
+  if (!array) {
+    return false;
+  }
+  if (PyArray_NDIM(array) != 1) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "solve_batch: dataset arrays must be 1D arrays");
+    return false;
+  }
+  const double* data = static_cast<const double*>(PyArray_DATA(array));
+  values->assign(data, data + PyArray_SIZE(array));
+  Py_DECREF(array);
+  return true;
+}
+
+/**
+ * Copy a matrix to a new C-contiguous NumPy array
+ */
+static PyObject* pyBatchMatrix(const Eigen::MatrixXd& matrix) {
+  npy_intp dims[2];
+  dims[0] = matrix.rows();
+  dims[1] = matrix.cols();
+  PyObject* array = PyArray_SimpleNew(2, dims, NPY_FLOAT64);
+  if (!array) {
+    return NULL;
+  }
+  Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+      static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array))),
+      matrix.rows(), matrix.cols()) = matrix;
+  return array;
+}
+
+/**
+ * Copy a vector to a new NumPy array
+ */
+static PyObject* pyBatchVector(const double* data, std::size_t n) {
+  npy_intp dims[1];
+  dims[0] = n;
+  PyObject* array = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  if (!array) {
+    return NULL;
+  }
+  std::copy(data, data + n,
+            static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array))));
+  return array;
+}
+
+static PyObject* pySolveBatch(PyObject* self, PyObject* args, PyObject* kwds) {
+  PyObject* datasetsObj = nullptr;
+  double threshold;
+  const char* method = "SLE";
+  unsigned long nThreads = 0;
+  PyObject* efficiency = nullptr;
+  int energySpread = 0;
+  double lambda = 1.e-9;
+  unsigned long upperTSVDIndex = 0;
+  unsigned long nIter = 10;
+  static const char *kwlist[] = {"datasets", "threshold", "method", "n_threads",
+                                 "efficiency", "energy_spread", "reg_param",
+                                 "upper_TSVD_index", "n_iter", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "Od|skOpdkk",
+                                   const_cast<char**>(kwlist),
+                                   &datasetsObj, &threshold, &method, &nThreads,
+                                   &efficiency, &energySpread, &lambda,
+                                   &upperTSVDIndex, &nIter)) {
+    return 0;
+  }
+  const std::string methodS = method;
+  if (methodS != "SLE" && methodS != "Tikhonov" &&
+      methodS != "TSVD" && methodS != "Iterative") {
+    PyErr_SetString(PyExc_ValueError,
+                    "solve_batch: method must be SLE, Tikhonov, TSVD or Iterative");
+    return 0;
+  }
+  if (efficiency == Py_None) {
+    efficiency = nullptr;
+  }
+  if (efficiency && !PyCallable_Check(efficiency)) {
+    PyErr_SetString(PyExc_TypeError, "solve_batch: a callable efficiency object is required");
+    return 0;
+  }
+  PyObject* sequence = PySequence_Fast(datasetsObj, "solve_batch: a sequence of datasets is required");
+  if (!sequence) {
+    return 0;
+  }
+  const Py_ssize_t nDatasets = PySequence_Fast_GET_SIZE(sequence);
+  std::vector<PyBatchDataset> datasets(nDatasets);
+  for (Py_ssize_t i = 0; i < nDatasets; ++i) {
+    PyObject* item = PySequence_Fast_GET_ITEM(sequence, i);
+    // (energy, vcs, vcs_err) or (energy, vcs, energy_err, vcs_err)
+    const Py_ssize_t size = PySequence_Check(item) ? PySequence_Size(item) : -1;
+    if (size != 3 && size != 4) {
+      Py_DECREF(sequence);
+      PyErr_SetString(PyExc_ValueError,
+                      "solve_batch: a dataset must be (energy, vcs, vcs_err) "
+                      "or (energy, vcs, energy_err, vcs_err)");
+      return 0;
+    }
+    auto& dataset = datasets[i];
+    std::vector<std::vector<double>*> columns;
+    if (size == 3) {
+      columns = {&dataset.energy, &dataset.vcs, &dataset.vcsErr};
+    } else {
+      columns = {&dataset.energy, &dataset.vcs, &dataset.energyErr, &dataset.vcsErr};
+    }
+    for (Py_ssize_t k = 0; k < size; ++k) {
+      PyObject* column = PySequence_GetItem(item, k);
+      const bool ok = column && pyBatchCopyArray(column, columns[k]);
+      Py_XDECREF(column);
+      if (!ok) {
+        Py_DECREF(sequence);
+        return 0;
+      }
+    }
+    if (size == 3) {
+      if (energySpread) {
+        Py_DECREF(sequence);
+        PyErr_SetString(PyExc_ValueError,
+                        "solve_batch: energy_spread requires (energy, vcs, energy_err, vcs_err) "
+                        "datasets");
+        return 0;
+      }
+      dataset.energyErr.assign(dataset.energy.size(), 0.);
+    }
+    const std::size_t n = dataset.energy.size();
+    if (dataset.vcs.size() != n || dataset.energyErr.size() != n ||
+        dataset.vcsErr.size() != n) {
+      Py_DECREF(sequence);
+      PyErr_SetString(PyExc_ValueError, "solve_batch: dataset arrays must have the same size");
+      return 0;
+    }
+    // Zero energy errors give a singular energy spread matrix
+    if (energySpread &&
+        std::any_of(dataset.energyErr.begin(), dataset.energyErr.end(),
+                    [](double err) {return !(err > 0);})) {
+      Py_DECREF(sequence);
+      PyErr_SetString(PyExc_ValueError,
+                      "solve_batch: energy_spread requires positive energy errors");
+      return 0;
+    }
+  }
+  Py_DECREF(sequence);
+  std::function<double(double, double)> effC = [](double, double) {return 1.;};
+  if (efficiency) {
+    // Python efficiency serializes the workers on the GIL
+    effC = [efficiency](double x, double en) {
+      PyGILGuard gil;
+      PyObject *arglist = Py_BuildValue("(dd)", x, en);
+      PyObject *rv = PyObject_CallObject(efficiency, arglist);
+      double result = PyFloat_AS_DOUBLE(rv);
+      Py_CLEAR(rv);
+      Py_CLEAR(arglist);
+      return result;
+    };
+  }
+  std::string errorMessage;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    parallelFor(datasets.size(), nThreads,
+                [&](std::size_t first, std::size_t last) {
+                  for (std::size_t i = first; i < last; ++i) {
+                    auto& dataset = datasets[i];
+                    std::unique_ptr<ISRSolverSLE> solver;
+                    const std::size_t n = dataset.energy.size();
+                    double* energy = dataset.energy.data();
+                    double* vcs = dataset.vcs.data();
+                    double* energyErr = dataset.energyErr.data();
+                    double* vcsErr = dataset.vcsErr.data();
+                    if (methodS == "Tikhonov") {
+                      auto tikhonov = new ISRSolverTikhonov(
+                          n, energy, vcs, energyErr, vcsErr, threshold, effC);
+                      tikhonov->setLambda(lambda);
+                      solver.reset(tikhonov);
+                    } else if (methodS == "TSVD") {
+                      auto tsvd = new ISRSolverTSVD(
+                          n, energy, vcs, energyErr, vcsErr, threshold, effC);
+                      tsvd->setUpperTSVDIndex(upperTSVDIndex > 0 ? upperTSVDIndex : n);
+                      solver.reset(tsvd);
+                    } else if (methodS == "Iterative") {
+                      auto iter = new IterISRInterpSolver(
+                          n, energy, vcs, energyErr, vcsErr, threshold, effC);
+                      iter->setNumOfIters(nIter);
+                      solver.reset(iter);
+                    } else {
+                      solver.reset(new ISRSolverSLE(
+                          n, energy, vcs, energyErr, vcsErr, threshold, effC));
+                    }
+                    if (energySpread) {
+                      solver->enableEnergySpread();
+                    } else {
+                      solver->disableEnergySpread();
+                    }
+                    solver->solve();
+                    // The solver sorts the points by energy
+                    dataset.ecm = solver->ecm();
+                    dataset.bcs = solver->bcs();
+                    dataset.bcsCovMatrix = solver->getBornCSCovMatrix();
+                  }
+                });
+  } catch (const std::exception& e) {
+    errorMessage = e.what();
+    if (errorMessage.empty()) {
+      errorMessage = "solve_batch: solver failed";
+    }
+  } catch (...) {
+    errorMessage = "solve_batch: solver failed";
+  }
+  Py_END_ALLOW_THREADS
+  if (!errorMessage.empty()) {
+    PyErr_SetString(PyExc_RuntimeError, errorMessage.c_str());
+    return 0;
+  }
+  PyObject* result = PyList_New(nDatasets);
+  if (!result) {
+    return 0;
+  }
+  for (Py_ssize_t i = 0; i < nDatasets; ++i) {
+    const auto& dataset = datasets[i];
+    PyObject* item = PyDict_New();
+    PyObject* ecm = pyBatchVector(dataset.ecm.data(), dataset.ecm.size());
+    PyObject* bcs = pyBatchVector(dataset.bcs.data(), dataset.bcs.size());
+    PyObject* cov = pyBatchMatrix(dataset.bcsCovMatrix);
+    if (!item || !ecm || !bcs || !cov) {
+      Py_XDECREF(item);
+      Py_XDECREF(ecm);
+      Py_XDECREF(bcs);
+      Py_XDECREF(cov);
+      Py_DECREF(result);
+      return 0;
+    }
+    PyDict_SetItemString(item, "ecm", ecm);
+    PyDict_SetItemString(item, "bcs", bcs);
+    PyDict_SetItemString(item, "bcs_cov_matrix", cov);
+    Py_DECREF(ecm);
+    Py_DECREF(bcs);
+    Py_DECREF(cov);
+    PyList_SET_ITEM(result, i, item);
+  }
+  return result;
+}
+
+static char solveBatch_docs[] =
+    "solve_batch(datasets, threshold, method = 'SLE', n_threads = 0, efficiency = None, "
+    "energy_spread = False, reg_param = 1.e-9, upper_TSVD_index = 0, n_iter = 10): "
+    "solve a list of (energy, vcs, vcs_err) or (energy, vcs, energy_err, vcs_err) datasets "
+    "in parallel on C++ threads (n_threads = 0 means all cores). energy_spread requires "
+    "positive energy errors. Returns a list of dicts with ecm, bcs and bcs_cov_matrix "
+    "NumPy arrays, the points are sorted by energy.\n";
+
+#endif
@@ -8,9 +8,9 @@
 #include <Python.h>
 #include <structmember.h>
 #include <numpy/arrayobject.h>
-#include "Integration.hpp"
-#include "KuraevFadin.hpp"
 #include "PyUtils.hpp"
+#include "PyVectorized.hpp"
+#include "RadiatorOperator.hpp"
 
 typedef struct {
   PyObject_HEAD
@@ -26,6 +26,8 @@ typedef struct {
   bool energy_spread;
   double errordef;
   PyObject* param_names;
+  bool vectorized;
+  RadiatorOperator* radiator;
 } PyFitVCSObject;
 
 static PyMemberDef PyFitVCS_members[] = {
@@ -44,6 +46,7 @@ PyFitVCS_dealloc(PyFitVCSObject *self)
   Py_XDECREF(self->bcsModelFCN);
   Py_XDECREF(self->effFCN);
   Py_XDECREF(self->param_names);
+  delete self->radiator;
   Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
@@ -60,8 +63,11 @@ PyFitVCS_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     self->vcsErr = NULL;
     self->bcsModelFCN = NULL;
     self->effFCN = NULL;
+    self->vectorized = false;
+    self->radiator = nullptr;
     self->effLambda =
         [self](double x, double en) {
+          PyGILGuard gil;
           PyObject *arglist = Py_BuildValue("(dd)", x, en);
           PyObject *rv = PyObject_CallObject(self->effFCN, arglist);
           double result = PyFloat_AS_DOUBLE(rv);
@@ -77,18 +83,21 @@ static int
 PyFitVCS_init(PyFitVCSObject *self, PyObject *args, PyObject *kwds) {
   static const char *kwlist[] =
       {"threshold", "energy", "vcs", "energy_err",
-       "vcs_err", "bcs_model", "efficiency", NULL};
+       "vcs_err", "bcs_model", "efficiency", "vectorized", NULL};
+  int vectorized = 0;
   if (!PyArg_ParseTupleAndKeywords(
-          args, kwds, "dO!O!O!O!OO",
+          args, kwds, "dO!O!O!O!OO|p",
           const_cast<char**>(kwlist),
           &(self->threshold),
           &PyArray_Type, &(self->energy),
           &PyArray_Type, &(self->vcs),
           &PyArray_Type, &(self->energyErr),
           &PyArray_Type, &(self->vcsErr),
-          &(self->bcsModelFCN), &(self->effFCN))) {
+          &(self->bcsModelFCN), &(self->effFCN),
+          &vectorized)) {
     return -1;
   }
+  self->vectorized = vectorized;
   if (!PyCallable_Check(self->bcsModelFCN)) {
     PyErr_SetString(PyExc_TypeError, "IterISRSolverUseVCSFit: a callable Born cross section object is required");
     return -1;
@@ -128,8 +137,43 @@ PyFitVCS_init(PyFitVCSObject *self, PyObject *args, PyObject *kwds) {
   return 0;
 }
 
+/**
+ * Chi-square with one call of the Born cross section model per pass:
+ * bcs_model(energy_array, *params, **kwds)
+ */
+static PyObject *PyFitVCS_vectorized_call(PyFitVCSObject *self, PyObject *args, PyObject* kwds) {
+  double* energyC = (double*) PyArray_DATA(self->energy);
+  double* energyErrC = (double*) PyArray_DATA(self->energyErr);
+  double* vcsC = (double*) PyArray_DATA(self->vcs);
+  double* vcsErrC = (double*) PyArray_DATA(self->vcsErr);
+  npy_intp dim = PyArray_DIMS(self->energy)[0];
+  // Rules and efficiency do not depend on the model parameters
+  if (!self->radiator) {
+    self->radiator = pyMakeVectorizedRadiator(
+        dim, energyC, self->energy_spread ? energyErrC : nullptr,
+        self->threshold, self->effFCN);
+    if (!self->radiator) {
+      return NULL;
+    }
+  }
+  std::vector<double> modelVCS;
+  if (!pyVectorizedConvolutions(*(self->radiator), self->bcsModelFCN, args, kwds, &modelVCS)) {
+    return NULL;
+  }
+  double result = 0;
+  for (npy_intp i = 0; i < dim; ++i) {
+    double dchi2 = (vcsC[i] - modelVCS[i]) / vcsErrC[i];
+    dchi2 *= dchi2;
+    result += dchi2;
+  }
+  return PyFloat_FromDouble(result);
+}
+
 static PyObject *PyFitVCS_call(PyObject *callable, PyObject *args, PyObject* kwds) {
   auto self = reinterpret_cast<PyFitVCSObject*>(callable);
+  if (self->vectorized) {
+    return PyFitVCS_vectorized_call(self, args, kwds);
+  }
   Py_XINCREF(args);
   double* energyC = (double*) PyArray_DATA(self->energy);
   double* energyErrC = (double*) PyArray_DATA(self->energyErr);
@@ -149,38 +193,19 @@ static PyObject *PyFitVCS_call(PyObject *callable, PyObject *args, PyObject* kwd
   }
   std::function<double(double)> bcsModelLambda =
       [&argtuple, self, kwds](double en) {
+        PyGILGuard gil;
+        Py_XDECREF(PyTuple_GET_ITEM(argtuple, 0));
         PyTuple_SET_ITEM(argtuple, 0, PyFloat_FromDouble(en));
         PyObject* rv = PyObject_Call(self->bcsModelFCN, argtuple, kwds);
         double result = PyFloat_AS_DOUBLE(rv);
         Py_XDECREF(rv);
         return result;
       };
+  const RadiatorOperator radiator(self->threshold, self->effLambda);
+  // Python callbacks are called for each node, so the GIL is kept
   for (npy_intp i = 0; i < dim; ++i) {
-    double sT = self->threshold * self->threshold;
-    const double energy = energyC[i];
-    double modelVCS = 0;
-    if (self->energy_spread) {
-      std::function<double(double)> fcnVCSNoSpread =
-          [bcsModelLambda, sT, self](double en) {
-            const double s = en * en;
-            double result = 0;
-            if (s <= sT) {
-              return result;
-            }
-            result = convolutionKuraevFadin(
-                en, bcsModelLambda,
-                0, 1. - sT / s,
-                self->effLambda);
-            return result;
-          };
-      const double sigmaEn2 = energyErrC[i] * energyErrC[i];
-      modelVCS = gaussian_conv(energy, sigmaEn2, fcnVCSNoSpread);
-    } else {
-      modelVCS = convolutionKuraevFadin(
-          energy, bcsModelLambda,
-          0, 1. - sT / energy / energy,
-          self->effLambda);
-    }
+    const double sigmaEn2 = self->energy_spread ? energyErrC[i] * energyErrC[i] : 0.;
+    const double modelVCS = radiator.apply(energyC[i], sigmaEn2, bcsModelLambda);
     double dchi2 = (vcsC[i] - modelVCS) / vcsErrC[i];
     dchi2 *= dchi2;
     result += dchi2;
@@ -212,11 +237,15 @@ static PyObject *PyFitVCS_minuit(PyFitVCSObject *self, PyObject *args, PyObject
 
 static PyObject *PyFitVCS_enable_energy_spread(PyFitVCSObject *self) {
   self->energy_spread = true;
+  delete self->radiator;
+  self->radiator = nullptr;
   return PyLong_FromSsize_t(0);
 }
 
 static PyObject *PyFitVCS_disable_energy_spread(PyFitVCSObject *self) {
   self->energy_spread = false;
+  delete self->radiator;
+  self->radiator = nullptr;
   return PyLong_FromSsize_t(0);
 }
 
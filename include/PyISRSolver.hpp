@@ -6,6 +6,8 @@
 #include <structmember.h>
 #include <numpy/arrayobject.h>
 #include "ISRSolverSLE.hpp"
+#include "PyUtils.hpp"
+#include "Utils.hpp"
 
 typedef struct {
   PyObject_HEAD
@@ -34,6 +36,32 @@ PyISRSolver_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
   return reinterpret_cast<PyObject*>(self);
 }
 
+/**
+ * Read-only zero-copy NumPy view of solver data. The view keeps
+ * the owner object alive through its base object.
+ * @param owner an object that owns the data
+ * @param data a pointer to the data (column-major order for matrices)
+ * @param rows a number of rows
+ * @param cols a number of columns (0 for a 1D array)
+ */
+static PyObject* pyReadOnlyView(PyObject* owner, const double* data,
+                                npy_intp rows, npy_intp cols = 0) {
+  npy_intp dims[2] = {rows, cols};
+  const int nd = cols > 0 ? 2 : 1;
+  PyObject* array = PyArray_New(&PyArray_Type, nd, dims, NPY_FLOAT64, NULL,
+                                const_cast<double*>(data), 0,
+                                NPY_ARRAY_FARRAY_RO, NULL);
+  if (!array) {
+    return NULL;
+  }
+  Py_INCREF(owner);
+  if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array), owner) < 0) {
+    Py_DECREF(array);
+    return NULL;
+  }
+  return array;
+}
+
 static PyObject *
 PyISRSolver_n(PyISRSolverObject *self, void *closure)
 {
@@ -64,43 +92,80 @@ PyISRSolverTikhonov_set_energy_sread_enabled(PyISRSolverObject *self, PyObject *
 }
 
 static PyObject *PyISRSolver_ecm(PyISRSolverObject *self) {
-  const std::size_t n = self->solver->getN();
-  npy_intp dims[1];
-  dims[0] = n;
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, extractECMPointer(self->solver));
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractECMPointer(self->solver), self->solver->getN());
 }
 
 static PyObject *PyISRSolver_ecm_err(PyISRSolverObject *self) {
-  const std::size_t n = self->solver->getN();
-  npy_intp dims[1];
-  dims[0] = n;
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, extractECMErrPointer(self->solver));
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractECMErrPointer(self->solver), self->solver->getN());
 }
 
 static PyObject *PyISRSolver_vcs(PyISRSolverObject *self) {
-  const std::size_t n = self->solver->getN();
-  npy_intp dims[1];
-  dims[0] = n;
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, extractVCSPointer(self->solver));
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractVCSPointer(self->solver), self->solver->getN());
 }
 
 static PyObject *PyISRSolver_vcs_err(PyISRSolverObject *self) {
-  const std::size_t n = self->solver->getN();
-  npy_intp dims[1];
-  dims[0] = n;
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, extractVCSErrPointer(self->solver));
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractVCSErrPointer(self->solver), self->solver->getN());
+}
+
+/**
+ * Set a full visible cross section covariance matrix
+ * (points in ascending order of center-of-mass energy)
+ */
+static PyObject *PyISRSolver_set_vcs_cov_matrix(PyISRSolverObject *self, PyObject *args) {
+  PyObject *obj = NULL;
+  if (!PyArg_ParseTuple(args, "O", &obj)) {
+    return NULL;
+  }
+  PyArrayObject *array = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(obj, NPY_FLOAT64, NPY_ARRAY_IN_FARRAY));
+  if (!array) {
+    return NULL;
+  }
+  const npy_intp n = self->solver->getN();
+  if (PyArray_NDIM(array) != 2 || PyArray_DIM(array, 0) != n || PyArray_DIM(array, 1) != n) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "ISRSolver: an n x n covariance matrix is required");
+    return NULL;
+  }
+  const Eigen::MatrixXd covMatrix = Eigen::Map<const Eigen::MatrixXd>(
+      reinterpret_cast<const double*>(PyArray_DATA(array)), n, n);
+  Py_DECREF(array);
+  try {
+    self->solver->setVisibleCSCovMatrix(covMatrix);
+  } catch (const VCSCovMatrixException&) {
+    PyErr_SetString(PyExc_ValueError, "ISRSolver: the covariance matrix is not positive definite");
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *PyISRSolver_vcs_cov_matrix(PyISRSolverObject *self) {
+  const Eigen::MatrixXd covMatrix = self->solver->getVisibleCSCovMatrix();
+  const npy_intp dims[2] = {covMatrix.rows(), covMatrix.cols()};
+  PyObject *array = PyArray_New(&PyArray_Type, 2, const_cast<npy_intp*>(dims), NPY_FLOAT64,
+                                NULL, NULL, 0, NPY_ARRAY_FARRAY, NULL);
+  if (!array) {
+    return NULL;
+  }
+  std::copy(covMatrix.data(), covMatrix.data() + covMatrix.size(),
+            reinterpret_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array))));
+  return array;
 }
 
 static PyObject *PyISRSolver_bcs(PyISRSolverObject *self) {
-  const std::size_t n = self->solver->getN();
-  npy_intp dims[1];
-  dims[0] = n;
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, extractBCSPointer(self->solver));
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractBCSPointer(self->solver), self->solver->getN());
 }
 
 static PyObject *PyISRSolver_solve(PyISRSolverObject *self) {
   // !!! TO-DO: return none
+  Py_BEGIN_ALLOW_THREADS
   self->solver->solve();
+  Py_END_ALLOW_THREADS
   return PyLong_FromSsize_t(0);
 }
 
@@ -108,12 +173,21 @@ static PyObject *PyISRSolver_save(PyISRSolverObject *self, PyObject *args, PyObj
   char* outputPath = NULL;
   char* visibleCSGraphName = NULL;
   char* bornCSGraphName = NULL;
-  static const char *kwlist[] = {"output_path", "vcs_name", "bcs_name", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|ss",
+  const char* products = "all";
+  static const char *kwlist[] = {"output_path", "vcs_name", "bcs_name", "products", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|sss",
                                    const_cast<char**>(kwlist),
                                    &outputPath,
                                    &visibleCSGraphName,
-                                   &bornCSGraphName)) {
+                                   &bornCSGraphName,
+                                   &products)) {
+    return 0;
+  }
+  unsigned productFlags;
+  try {
+    productFlags = parseOutputProducts(products);
+  } catch (const OutputProductException&) {
+    PyErr_SetString(PyExc_ValueError, "save: unknown output product");
     return 0;
   }
   std::string outputPathS = outputPath;
@@ -132,9 +206,12 @@ static PyObject *PyISRSolver_save(PyISRSolverObject *self, PyObject *args, PyObj
     bornCSGraphNameS = bornCSGraphName;
     //!!! delete [] bornCSGraphName;
   }
+  Py_BEGIN_ALLOW_THREADS
   self->solver->save(outputPathS,
                      {.visibleCSGraphName = visibleCSGraphNameS,
-                      .bornCSGraphName = bornCSGraphNameS});
+                      .bornCSGraphName = bornCSGraphNameS,
+                      .products = productFlags});
+  Py_END_ALLOW_THREADS
   return PyLong_FromSsize_t(0);
 }
 
@@ -171,8 +248,10 @@ PyISRSolver_init(PyISRSolverObject *self, PyObject *args, PyObject *kwds)
     PyErr_SetString(PyExc_TypeError, "ISRSolver: a callable efficiency object is required");
     return -1;
   }
+  // The solver calls efficiency while the GIL is released
   std::function<double(double, double)> effC =
       [self](double x, double en) {
+        PyGILGuard gil;
         PyObject *arglist = Py_BuildValue("(dd)", x, en);
         PyObject *rv = PyObject_CallObject(self->eff, arglist);
         double result = PyFloat_AS_DOUBLE(rv);
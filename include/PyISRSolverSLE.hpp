@@ -59,40 +59,26 @@ static PyGetSetDef PyISRSolverSLE_getsetters[] = {
 
 static PyObject *PyISRSolverSLE_bcs_cov_matrix(PyISRSolverObject *self) {
   const std::size_t n = self->solver->getN();
-  npy_intp dims[2];
-  dims[0] = n;
-  dims[1] = n;
   ISRSolverSLE* solver = reinterpret_cast<ISRSolverSLE*>(self->solver);
-  PyArrayObject* array = reinterpret_cast<PyArrayObject*>(PyArray_SimpleNewFromData(
-      2, dims, NPY_FLOAT64, extractBCSCovMatrix(solver)));
-  return PyArray_Transpose(array, NULL);
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractBCSCovMatrix(solver), n, n);
 }
 
 static PyObject *PyISRSolverSLE_bcs_inv_cov_matrix(PyISRSolverObject *self) {
   const std::size_t n = self->solver->getN();
-  npy_intp dims[2];
-  dims[0] = n;
-  dims[1] = n;
   ISRSolverSLE* solver = reinterpret_cast<ISRSolverSLE*>(self->solver);
-  Eigen::Map<Eigen::MatrixXd> cov(extractBCSCovMatrix(solver), n, n);
-  Eigen::MatrixXd icov = cov.inverse();
-  const int n2 = n * n;
-  double* data = new double[n2];
-  std::copy(icov.data(), icov.data() + n2, data);
-  PyArrayObject* array = reinterpret_cast<PyArrayObject*>(PyArray_SimpleNewFromData(
-      2, dims, NPY_FLOAT64, data));
-  return PyArray_Transpose(array, NULL);
+  const Eigen::MatrixXd* icov = nullptr;
+  Py_BEGIN_ALLOW_THREADS
+  icov = &(solver->getBornCSInvCovMatrix());
+  Py_END_ALLOW_THREADS
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self), icov->data(), n, n);
 }
 
 static PyObject *PyISRSolverSLE_intop_matrix(PyISRSolverObject *self) {
   const std::size_t n = self->solver->getN();
-  npy_intp dims[2];
-  dims[0] = n;
-  dims[1] = n;
   ISRSolverSLE* solver = reinterpret_cast<ISRSolverSLE*>(self->solver);
-  PyArrayObject* array = reinterpret_cast<PyArrayObject*>(PyArray_SimpleNewFromData(
-      2, dims, NPY_FLOAT64, extractIntOpMatrix(solver)));
-  return PyArray_Transpose(array, NULL);
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        extractIntOpMatrix(solver), n, n);
 }
 
 static PyMethodDef PyISRSolverSLE_methods[] = {
@@ -107,6 +93,10 @@ static PyMethodDef PyISRSolverSLE_methods[] = {
     {"ecm_err", (PyCFunction) PyISRSolver_ecm_err, METH_NOARGS, "Get center-of-mass energy errors"},
     {"vcs", (PyCFunction) PyISRSolver_vcs, METH_NOARGS, "Get visible cross section"},
     {"vcs_err", (PyCFunction) PyISRSolver_vcs_err, METH_NOARGS, "Get visible cross section errors"},
+    {"vcs_cov_matrix", (PyCFunction) PyISRSolver_vcs_cov_matrix, METH_NOARGS,
+     "Get visible cross section covariance matrix"},
+    {"set_vcs_cov_matrix", (PyCFunction) PyISRSolver_set_vcs_cov_matrix, METH_VARARGS,
+     "Set full visible cross section covariance matrix (ascending order of energy)"},
     {"bcs_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_cov_matrix, METH_NOARGS,
      "Get covariance matrix of the numerical solution (Born cross section)"},
     {"bcs_inv_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_inv_cov_matrix, METH_NOARGS,
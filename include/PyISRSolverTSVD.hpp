@@ -62,6 +62,10 @@ static PyMethodDef PyISRSolverTSVD_methods[] = {
     {"ecm_err", (PyCFunction) PyISRSolver_ecm_err, METH_NOARGS, "Get center-of-mass energy errors"},
     {"vcs", (PyCFunction) PyISRSolver_vcs, METH_NOARGS, "Get visible cross section"},
     {"vcs_err", (PyCFunction) PyISRSolver_vcs_err, METH_NOARGS, "Get visible cross section errors"},
+    {"vcs_cov_matrix", (PyCFunction) PyISRSolver_vcs_cov_matrix, METH_NOARGS,
+     "Get visible cross section covariance matrix"},
+    {"set_vcs_cov_matrix", (PyCFunction) PyISRSolver_set_vcs_cov_matrix, METH_VARARGS,
+     "Set full visible cross section covariance matrix (ascending order of energy)"},
     {"bcs_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_cov_matrix, METH_NOARGS,
      "Get covariance matrix of the numerical solution (Born cross section)"},
     {"bcs_inv_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_inv_cov_matrix, METH_NOARGS,
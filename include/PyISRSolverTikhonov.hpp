@@ -58,9 +58,20 @@ static PyObject *PyISRSolverTikhonov_make_LCurve(PyISRSolverObject *self, PyObje
   npy_intp dim = dims[0];
   double *lambdasC = (double*) PyArray_DATA(lambdas);
   auto solver = reinterpret_cast<ISRSolverTikhonov*>(self->solver);
-  double* x = new double[dim];
-  double* y = new double[dim];
-  double* curv = new double[dim];
+  // Results are written directly to arrays owned by NumPy
+  PyObject* aX = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  PyObject* aY = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  PyObject* aC = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  if (!aX || !aY || !aC) {
+    Py_XDECREF(aX);
+    Py_XDECREF(aY);
+    Py_XDECREF(aC);
+    return 0;
+  }
+  double* x = static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(aX)));
+  double* y = static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(aY)));
+  double* curv = static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(aC)));
+  Py_BEGIN_ALLOW_THREADS
   for (npy_intp i = 0; i < dim; ++i) {
     solver->setLambda(lambdasC[i]);
     solver->solve();
@@ -68,13 +79,14 @@ static PyObject *PyISRSolverTikhonov_make_LCurve(PyISRSolverObject *self, PyObje
     y[i] = solver->evalSmoothnessConstraintNorm2();
     curv[i] = -solver->evalLCurveCurvature();
   }
-  PyObject* aX = PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, x);
-  PyObject* aY = PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, y);
-  PyObject* aC = PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, curv);
+  Py_END_ALLOW_THREADS
   PyObject* result = PyDict_New();
   PyDict_SetItemString(result, "x", aX);
   PyDict_SetItemString(result, "y", aY);
   PyDict_SetItemString(result, "c", aC);
+  Py_DECREF(aX);
+  Py_DECREF(aY);
+  Py_DECREF(aC);
   return result;
 }
 
@@ -99,7 +111,9 @@ static PyObject *PyISRSolverTikhonov_solve_LCurve(PyISRSolverObject *self, PyObj
   /**
    * Run the L-curve curvature maximization
    */
+  Py_BEGIN_ALLOW_THREADS
   opt.optimize(z, minf);
+  Py_END_ALLOW_THREADS
   PyObject* pyLambda = PyFloat_FromDouble(z[0]);
   PyObject* pyMaxCurv = PyFloat_FromDouble(-minf);
   PyObject* result = PyDict_New();
@@ -120,6 +134,10 @@ static PyMethodDef PyISRSolverTikhonov_methods[] = {
     {"ecm_err", (PyCFunction) PyISRSolver_ecm_err, METH_NOARGS, "Get center-of-mass energy errors"},
     {"vcs", (PyCFunction) PyISRSolver_vcs, METH_NOARGS, "Get visible cross section"},
     {"vcs_err", (PyCFunction) PyISRSolver_vcs_err, METH_NOARGS, "Get visible cross section errors"},
+    {"vcs_cov_matrix", (PyCFunction) PyISRSolver_vcs_cov_matrix, METH_NOARGS,
+     "Get visible cross section covariance matrix"},
+    {"set_vcs_cov_matrix", (PyCFunction) PyISRSolver_set_vcs_cov_matrix, METH_VARARGS,
+     "Set full visible cross section covariance matrix (ascending order of energy)"},
     {"bcs_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_cov_matrix, METH_NOARGS,
      "Get covariance matrix of the numerical solution (Born cross section)"},
     {"bcs_inv_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_inv_cov_matrix, METH_NOARGS,
@@ -27,13 +27,92 @@ PyIterISRInterpSolver_setniter(PyISRSolverObject *self, PyObject *value, void *c
   return 0;
 }
 
+static PyObject *
+PyIterISRInterpSolver_gettolerance(PyISRSolverObject *self, void *closure)
+{
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  return PyFloat_FromDouble(solver->getTolerance());
+}
+
+static int
+PyIterISRInterpSolver_settolerance(PyISRSolverObject *self, PyObject *value, void *closure)
+{
+  if (value == NULL) {
+    PyErr_SetString(PyExc_TypeError, "Cannot delete the tolerance");
+    return -1;
+  }
+  const double tolerance = PyFloat_AsDouble(value);
+  if (PyErr_Occurred()) {
+    return -1;
+  }
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  solver->setTolerance(tolerance);
+  return 0;
+}
+
+static PyObject *
+PyIterISRInterpSolver_getandersondepth(PyISRSolverObject *self, void *closure)
+{
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  return PyLong_FromSsize_t(solver->getAndersonDepth());
+}
+
+static int
+PyIterISRInterpSolver_setandersondepth(PyISRSolverObject *self, PyObject *value, void *closure)
+{
+  if (value == NULL) {
+    PyErr_SetString(PyExc_TypeError, "Cannot delete the Anderson acceleration depth");
+    return -1;
+  }
+  if (!PyLong_Check(value)) {
+    PyErr_SetString(PyExc_TypeError,
+                    "The Anderson acceleration depth must be a long");
+    return -1;
+  }
+  const std::size_t depth = PyLong_AsSize_t(value);
+  if (PyErr_Occurred()) {
+    return -1;
+  }
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  solver->setAndersonDepth(depth);
+  return 0;
+}
+
+static PyObject *
+PyIterISRInterpSolver_getitercount(PyISRSolverObject *self, void *closure)
+{
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  return PyLong_FromSsize_t(solver->getIterationCount());
+}
+
+static PyObject *PyIterISRInterpSolver_residual_history(PyISRSolverObject *self) {
+  IterISRInterpSolver* solver = reinterpret_cast<IterISRInterpSolver*>(self->solver);
+  const std::vector<double>& residuals = solver->getResidualHistory();
+  npy_intp dims[1] = {static_cast<npy_intp>(residuals.size())};
+  PyObject *array = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  if (!array) {
+    return NULL;
+  }
+  std::copy(residuals.begin(), residuals.end(),
+            reinterpret_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array))));
+  return array;
+}
+
 static PyGetSetDef PyIterISRInterpSolver_getsetters[] = {
   {"n", (getter) PyISRSolver_n, NULL, "Number of points", NULL},
   {"energy_spread_enabled", (getter) PyISRSolver_get_energy_sread_enabled,
    (setter) PyISRSolverTikhonov_set_energy_sread_enabled, "Energy spread flag", NULL},
   {"n_iter", (getter) PyIterISRInterpSolver_getniter,
    (setter)  PyIterISRInterpSolver_setniter,
-   "Number of iterations", NULL},
+   "Maximum number of iterations", NULL},
+  {"tolerance", (getter) PyIterISRInterpSolver_gettolerance,
+   (setter) PyIterISRInterpSolver_settolerance,
+   "Tolerance on the relative change of the radiative correction", NULL},
+  {"anderson_depth", (getter) PyIterISRInterpSolver_getandersondepth,
+   (setter) PyIterISRInterpSolver_setandersondepth,
+   "Depth of the Anderson acceleration", NULL},
+  {"iter_count", (getter) PyIterISRInterpSolver_getitercount, NULL,
+   "Number of iterations performed by the last solve", NULL},
   {NULL}  /* Sentinel */
 };
 
@@ -49,6 +128,10 @@ static PyMethodDef PyIterISRInterpSolver_methods[] = {
     {"ecm_err", (PyCFunction) PyISRSolver_ecm_err, METH_NOARGS, "Get center-of-mass energy errors"},
     {"vcs", (PyCFunction) PyISRSolver_vcs, METH_NOARGS, "Get visible cross section"},
     {"vcs_err", (PyCFunction) PyISRSolver_vcs_err, METH_NOARGS, "Get visible cross section errors"},
+    {"vcs_cov_matrix", (PyCFunction) PyISRSolver_vcs_cov_matrix, METH_NOARGS,
+     "Get visible cross section covariance matrix"},
+    {"set_vcs_cov_matrix", (PyCFunction) PyISRSolver_set_vcs_cov_matrix, METH_VARARGS,
+     "Set full visible cross section covariance matrix (ascending order of energy)"},
     {"bcs_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_cov_matrix, METH_NOARGS,
      "Get covariance matrix of the numerical solution (Born cross section)"},
     {"bcs_inv_cov_matrix", (PyCFunction) PyISRSolverSLE_bcs_inv_cov_matrix, METH_NOARGS,
@@ -56,6 +139,8 @@ static PyMethodDef PyIterISRInterpSolver_methods[] = {
     {"intop_matrix", (PyCFunction) PyISRSolverSLE_intop_matrix, METH_NOARGS,
      "Integral operator matrix"},
     {"set_interp_settings", (PyCFunction) PyISRSolverSLE_set_interp_settings, METH_VARARGS, "Set interpolation settings"},
+    {"residual_history", (PyCFunction) PyIterISRInterpSolver_residual_history, METH_NOARGS,
+     "Relative change of the radiative correction at each iteration"},
     {NULL}  /* Sentinel */
 };
 
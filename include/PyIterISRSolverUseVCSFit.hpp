@@ -10,8 +10,12 @@
 #include <gsl/gsl_spline.h>
 #include <algorithm>
 #include <functional>
-#include "Integration.hpp"
-#include "KuraevFadin.hpp"
+#include <memory>
+#include "EnergyGrid.hpp"
+#include "PyISRSolver.hpp"
+#include "PyUtils.hpp"
+#include "PyVectorized.hpp"
+#include "RadiativeCorrectionGrid.hpp"
 
 #include <iostream>
 
@@ -28,6 +32,7 @@ typedef struct {
   double threshold;
   unsigned int npoints;
   unsigned int niter;
+  bool vectorized;
   Eigen::VectorXd rad_corr;
   Eigen::VectorXd bcs;
   Eigen::VectorXd bcsErr;
@@ -58,9 +63,11 @@ PyIterISRSolverUseVCSFit_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     self->npoints = 100;
     self->niter = 10;
     self->energy_spread = false;
+    self->vectorized = false;
     self->sigmaEn = 0.;
     self->effLambda =
         [self](double x, double en) {
+          PyGILGuard gil;
           PyObject *arglist = Py_BuildValue("(dd)", x, en);
           PyObject *rv = PyObject_CallObject(self->effFCN, arglist);
           double result = PyFloat_AS_DOUBLE(rv);
@@ -75,18 +82,21 @@ PyIterISRSolverUseVCSFit_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 static int
 PyIterISRSolverUseVCSFit_init(PyIterISRSolverUseVCSFitObject *self, PyObject *args, PyObject *kwds) {
   static const char *kwlist[] =
-      {"threshold", "energy", "vcs", "vcs_err", "cs_fcn", "efficiency", "energy_spread", NULL};
+      {"threshold", "energy", "vcs", "vcs_err", "cs_fcn", "efficiency", "energy_spread",
+       "vectorized", NULL};
+  int vectorized = 0;
   if (!PyArg_ParseTupleAndKeywords(
-          args, kwds, "dO!O!O!OO|d",
+          args, kwds, "dO!O!O!OO|dp",
           const_cast<char**>(kwlist),
           &(self->threshold),
           &PyArray_Type, &(self->energy),
           &PyArray_Type, &(self->vcs),
           &PyArray_Type, &(self->vcsErr),
           &(self->vcsFitFCN), &(self->effFCN),
-          &(self->sigmaEn))) {
+          &(self->sigmaEn), &vectorized)) {
     return -1;
   }
+  self->vectorized = vectorized;
   if (!PyCallable_Check(self->vcsFitFCN)) {
     PyErr_SetString(PyExc_TypeError, "IterISRSolverUseVCSFit: a callable cross section object is required");
     return -1;
@@ -118,123 +128,154 @@ static PyObject *PyIterISRSolverUseFit_disable_energy_spread(
 static PyObject *PyIterISRSolverUseFit_solve(
     PyIterISRSolverUseVCSFitObject *self, PyObject *args, PyObject *kwds) {
   static const char *kwlist[] =
-      {"verbose",  NULL};
-  bool verbose = false;
+      {"verbose", "threads", "grid_tolerance", "max_points", NULL};
+  int verbose = 0;
+  Py_ssize_t nThreads = 1;
+  double gridTolerance = 0;
+  Py_ssize_t maxPoints = 10000;
   if (!PyArg_ParseTupleAndKeywords(
-          args, kwds, "|p",
+          args, kwds, "|pndn",
           const_cast<char**>(kwlist),
-          &verbose)) {
+          &verbose, &nThreads, &gridTolerance, &maxPoints)) {
     return 0;
   }
-  Eigen::VectorXd ecm = Eigen::VectorXd::Zero(self->npoints);
   PyObject *maxelem = PyArray_Max(self->energy, 0, NULL);
   const double maxen = PyFloat_AS_DOUBLE(maxelem);
   Py_XDECREF(maxelem);
-  const double eh = (maxen - self->threshold) / (self->npoints - 1.);
-  for (unsigned int i = 0; i < self->npoints; ++i) {
-    ecm(i) = self->threshold + eh * i;
-  }
-  Eigen::VectorXd radCorr = Eigen::VectorXd::Zero(self->npoints);
-  gsl_interp_accel *acc = gsl_interp_accel_alloc ();
-  gsl_spline *spline = gsl_spline_alloc(gsl_interp_linear, self->npoints);
-  gsl_spline_init (spline, ecm.data(), radCorr.data(), self->npoints);
-  std::function<double(double)> radFCN =
-      [&spline, &acc](double en) {
-        double result = gsl_spline_eval(spline, en, acc);
-        return result;
-      };
   /**
-   * Born cross section function
+   * Visible cross section fit function at a set of energies (one call
+   * in the vectorized mode), energies above maxen use the value at maxen
    */
-  std::function<double(double)> born_fcn =
-      [maxen, &radFCN, &self](double en) {
-        if (en <= self->threshold) {
-          return 0.;
-        }
-        double result = 0;
-        if (en >= maxen) {
-          PyObject* argtuple = PyTuple_New(1);
-          PyTuple_SET_ITEM(argtuple, 0, PyFloat_FromDouble(maxen));
-          PyObject* rv = PyObject_Call(self->vcsFitFCN, argtuple, NULL);
-          const double tmp_val = PyFloat_AS_DOUBLE(rv);
-          Py_XDECREF(rv);
-          result = tmp_val / (1. + radFCN(maxen));
-          return result;
+  bool failed = false;
+  auto evalFit = [self, maxen, &failed](const std::vector<double>& energy,
+                                        std::vector<double>* values) {
+    values->assign(energy.size(), 0.);
+    if (failed) {
+      return;
+    }
+    std::vector<double> clamped(energy);
+    for (auto& en : clamped) {
+      en = std::min(en, maxen);
+    }
+    if (self->vectorized) {
+      failed = !pyVectorizedCall(self->vcsFitFCN, clamped, NULL, NULL, NULL, values);
+    } else {
+      for (std::size_t k = 0; k < clamped.size() && !failed; ++k) {
+        if (clamped[k] <= self->threshold) {
+          continue;
         }
         PyObject* argtuple = PyTuple_New(1);
-        PyTuple_SET_ITEM(argtuple, 0, PyFloat_FromDouble(en));
+        PyTuple_SET_ITEM(argtuple, 0, PyFloat_FromDouble(clamped[k]));
         PyObject* rv = PyObject_Call(self->vcsFitFCN, argtuple, NULL);
-        const double tmp_val = PyFloat_AS_DOUBLE(rv);
-        Py_XDECREF(rv);
-        result = tmp_val / (1. + radFCN(en));
-        return result;
-      };
-  std::function<double(double)> vcs_fcn_no_spread =
-      [&self, &born_fcn](double en) {
-        if (en <= self->threshold) {
-          return 0.;
-        }
-        const double s_threshold = self->threshold * self->threshold;
-        const double s = en * en;
-        double result = 0;
-        if (self->effFCN) {
-          result = convolutionKuraevFadin(en, born_fcn, 0, 1. - s_threshold / s,
-                                          self->effLambda);
-        } else {
-          result = convolutionKuraevFadin(en, born_fcn, 0, 1. - s_threshold / s);
-        }
-        return result;
-      };
-  std::function<double(double)> vcs_fcn =
-      [&self, &vcs_fcn_no_spread](double en) {
-        double result = 0;
-        if (self->energy_spread) {
-          result = gaussian_conv(en, self->sigmaEn * self->sigmaEn,
-                                 vcs_fcn_no_spread);
-        } else {
-          result = vcs_fcn_no_spread(en);
+        Py_DECREF(argtuple);
+        if (!rv) {
+          failed = true;
+          break;
         }
-        return result;
-      };
-  Eigen::VectorXd tmpRad = Eigen::VectorXd::Zero(self->npoints);
+        (*values)[k] = PyFloat_AsDouble(rv);
+        Py_DECREF(rv);
+        failed = PyErr_Occurred() != NULL;
+      }
+    }
+    for (std::size_t k = 0; k < clamped.size(); ++k) {
+      if (clamped[k] <= self->threshold) {
+        (*values)[k] = 0;
+      }
+    }
+  };
+  /**
+   * Uniform grid or a grid refined where the fit function
+   * has high curvature
+   */
+  std::vector<double> grid(self->npoints);
+  if (gridTolerance > 0) {
+    grid = adaptiveEnergyGrid(self->threshold, maxen, self->npoints, gridTolerance,
+                              std::max<Py_ssize_t>(maxPoints, 2), evalFit);
+    if (failed) {
+      return 0;
+    }
+  } else {
+    const double eh = (maxen - self->threshold) / (self->npoints - 1.);
+    for (unsigned int i = 0; i < self->npoints; ++i) {
+      grid[i] = self->threshold + eh * i;
+    }
+  }
+  const std::size_t n = grid.size();
+  Eigen::VectorXd ecm = Eigen::Map<const Eigen::VectorXd>(grid.data(), n);
+  Eigen::VectorXd radCorr = Eigen::VectorXd::Zero(n);
+  /**
+   * Kuraev-Fadin rules of the grid points are prepared once. In the
+   * vectorized mode the efficiency and the visible cross section fit function
+   * are called once with the rule nodes of all grid points followed by
+   * the grid points themselves.
+   */
+  std::unique_ptr<RadiativeCorrectionGrid> radGrid;
+  std::vector<double> spread(n, self->sigmaEn);
+  const double* energyErr = self->energy_spread ? spread.data() : nullptr;
+  if (self->vectorized) {
+    std::unique_ptr<RadiatorOperator> radiator(
+        pyMakeVectorizedRadiator(n, ecm.data(), energyErr,
+                                 self->threshold, self->effFCN));
+    if (!radiator) {
+      return 0;
+    }
+    radGrid.reset(new RadiativeCorrectionGrid(*radiator));
+  } else {
+    const std::size_t threads = std::max<Py_ssize_t>(nThreads, 0);
+    // The efficiency callback reacquires the GIL when it is called
+    Py_BEGIN_ALLOW_THREADS
+    RadiatorOperator radiator(self->threshold, self->effLambda);
+    radiator.setPoints(n, ecm.data(), energyErr, threads);
+    radGrid.reset(new RadiativeCorrectionGrid(radiator));
+    Py_END_ALLOW_THREADS
+  }
+  std::vector<double> fitEnergy = radGrid->getNodeEnergies();
+  fitEnergy.insert(fitEnergy.end(), grid.begin(), grid.end());
+  std::vector<double> fitValues;
+  evalFit(fitEnergy, &fitValues);
+  if (failed) {
+    return 0;
+  }
+  const std::size_t nNodes = radGrid->getNodeEnergies().size();
+  radGrid->setModelValues(Eigen::Map<const Eigen::VectorXd>(fitValues.data(), nNodes),
+                          Eigen::Map<const Eigen::VectorXd>(fitValues.data() + nNodes, n));
+  Eigen::VectorXd tmpRad = Eigen::VectorXd::Zero(n);
+  Py_BEGIN_ALLOW_THREADS
   for (unsigned iter = 0; iter < self->niter; ++iter) {
     if (verbose) {
+      PyGILGuard gil;
       std::cout << "ITER: " << iter << " / " << self->niter << std::endl;
     }
-    for (unsigned int i = 0; i < self->npoints; ++i) {
-      tmpRad(i) = vcs_fcn(ecm(i)) / born_fcn(ecm(i)) - 1;
-      if (std::isnan(tmpRad(i))) {
-        tmpRad(i) = 0;
-      }
-    }
-    std::copy(tmpRad.data(), tmpRad.data() + self->npoints, radCorr.data());
-    gsl_spline_free(spline);
-    gsl_interp_accel_free(acc);
-    acc = gsl_interp_accel_alloc();
-    spline = gsl_spline_alloc(gsl_interp_linear, self->npoints);
-    gsl_spline_init(spline, ecm.data(), radCorr.data(), self->npoints);
+    radGrid->iterate(radCorr, &tmpRad);
+    radCorr = tmpRad;
   }
+  Py_END_ALLOW_THREADS
+  gsl_interp_accel *acc = gsl_interp_accel_alloc();
+  gsl_spline *spline = gsl_spline_alloc(gsl_interp_linear, n);
+  gsl_spline_init(spline, ecm.data(), radCorr.data(), n);
   npy_intp *dims = PyArray_DIMS(self->energy);
   npy_intp dim = dims[0];
-  self->rad_corr = Eigen::VectorXd(dim);
-  self->bcs = Eigen::VectorXd(dim);
-  self->bcsErr = Eigen::VectorXd(dim);
+  // resize keeps the buffers (and views returned earlier) when dim is unchanged
+  self->rad_corr.resize(dim);
+  self->bcs.resize(dim);
+  self->bcsErr.resize(dim);
   double* energyC = (double*) PyArray_DATA(self->energy);
   double* vcsC = (double*) PyArray_DATA(self->vcs);
   double* vcsErrC = (double*) PyArray_DATA(self->vcsErr);
   for (npy_intp i = 0; i < dim; ++i) {
     double energy = energyC[i];
-    (self->rad_corr)(i) = radFCN(energy);
+    (self->rad_corr)(i) = gsl_spline_eval(spline, energy, acc);
     (self->bcs)(i) = vcsC[i] / (1. + (self->rad_corr)(i));
     (self->bcsErr)(i) = vcsErrC[i] / (1. + (self->rad_corr)(i));
   }
+  gsl_spline_free(spline);
+  gsl_interp_accel_free(acc);
   return PyLong_FromSsize_t(0);
 }
 
 static PyObject *PyIterISRSolverUseFit_rad_corr(PyIterISRSolverUseVCSFitObject *self) {
-  npy_intp dims[1];
-  dims[0] = self->rad_corr.size();
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, self->rad_corr.data());
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        self->rad_corr.data(), self->rad_corr.size());
 }
 
 static PyObject *PyIterISRSolverUseFit_ecm(PyIterISRSolverUseVCSFitObject *self) {
@@ -256,15 +297,13 @@ static PyObject *PyIterISRSolverUseFit_vcs_err(PyIterISRSolverUseVCSFitObject *s
 }
 
 static PyObject *PyIterISRSolverUseFit_bcs(PyIterISRSolverUseVCSFitObject *self) {
-  npy_intp dims[1];
-  dims[0] = self->bcs.size();
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, self->bcs.data());
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        self->bcs.data(), self->bcs.size());
 }
 
 static PyObject *PyIterISRSolverUseFit_bcs_err(PyIterISRSolverUseVCSFitObject *self) {
-  npy_intp dims[1];
-  dims[0] = self->bcsErr.size();
-  return PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, self->bcsErr.data());
+  return pyReadOnlyView(reinterpret_cast<PyObject*>(self),
+                        self->bcsErr.data(), self->bcsErr.size());
 }
 
 static PyMethodDef PyIterISRSolverUseFit_methods[] = {
@@ -5,6 +5,7 @@
 #include <Python.h>
 #include <structmember.h>
 #include "KuraevFadin.hpp"
+#include "PyVectorized.hpp"
 static PyObject* pyKernelKuraevFadin(PyObject* self,
                                    PyObject* args) {
   double xC;
@@ -23,16 +24,39 @@ static PyObject* pyConvolutionKuraevFadin(PyObject* self,
   double energyC;
   double minXC;
   double maxXC;
-  static const char *kwlist[] = {"energy", "fcn", "min_x", "max_x", "efficiency", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dOdd|O",
+  int vectorized = 0;
+  static const char *kwlist[] = {"energy", "fcn", "min_x", "max_x", "efficiency", "vectorized", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dOdd|Op",
                                    const_cast<char**>(kwlist),
-                                   &energyC, &cb, &minXC, &maxXC, &efficiency)) {
+                                   &energyC, &cb, &minXC, &maxXC, &efficiency,
+                                   &vectorized)) {
     return 0;
   }
   if (!PyCallable_Check(cb)) {
     PyErr_SetString(PyExc_TypeError, "convolutionKuraevFadin: a callable is required");
     return 0;
   }
+  if (efficiency == Py_None) {
+    efficiency = nullptr;
+  }
+  if (vectorized) {
+    // fcn(energy_array) and efficiency(x_array, energy_array) are called
+    // once on the nodes of a fixed-node rule
+    KuraevFadinRule rule = ruleKuraevFadin(energyC, minXC, maxXC);
+    if (!pyApplyVectorizedEfficiency(&rule, efficiency)) {
+      return 0;
+    }
+    std::vector<double> values;
+    if (!rule.energy.empty() &&
+        !pyVectorizedCall(cb, rule.energy, NULL, NULL, NULL, &values)) {
+      return 0;
+    }
+    double result = 0;
+    for (std::size_t k = 0; k < values.size(); ++k) {
+      result += rule.weight[k] * values[k];
+    }
+    return PyFloat_FromDouble(result);
+  }
   std::function<double(double)> fcnC =
       [cb](double en) {
         PyObject *arglist = Py_BuildValue("(d)", en);;
@@ -63,6 +87,7 @@ static char kernelKuraevFadin_docs[] =
     "kernelKuraevFadin(x, s): Any message you want to put here!!\n";
 
 static char convolutionKuraevFadin_docs[] =
-    "convolutionKuraevFadin(energy, fcn, min_x, max_x, efficiency = lambda x, energy: 1.): Any message you want to put here!!\n";
+    "convolutionKuraevFadin(energy, fcn, min_x, max_x, efficiency = lambda x, energy: 1., vectorized = False): "
+    "if vectorized is True, fcn and efficiency are called once with NumPy arrays of quadrature nodes\n";
 
 #endif
@@ -1,6 +1,21 @@
 #ifndef _PY_UTILS_HPP_
 #define _PY_UTILS_HPP_
+#include <Python.h>
 
 #define offset_of(st, m) ((size_t)((char *)&((st *)0)->m - (char *)0))
 
+/**
+ * Acquires the GIL for the lifetime of the object. It is used by C++
+ * callbacks that call Python code while the GIL is released.
+ */
+class PyGILGuard {
+ public:
+  PyGILGuard() : _state(PyGILState_Ensure()) {}
+  ~PyGILGuard() { PyGILState_Release(_state); }
+  PyGILGuard(const PyGILGuard&) = delete;
+  PyGILGuard& operator=(const PyGILGuard&) = delete;
+ private:
+  PyGILState_STATE _state;
+};
+
 #endif
@@ -0,0 +1,169 @@
+#ifndef _PY_VECTORIZED_HPP_
+#define _PY_VECTORIZED_HPP_
+#define PY_SSIZE_T_CLEAN
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <algorithm>
+#include <vector>
+#include <Python.h>
+#include <numpy/arrayobject.h>
+#include "KuraevFadin.hpp"
+#include "RadiatorOperator.hpp"
+
+/**
+ * Copy a vector to a new NumPy array
+ */
+static PyObject* pyArrayFromVector(const std::vector<double>& values) {
+  npy_intp dims[1];
+  dims[0] = values.size();
+  PyObject* array = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+  if (!array) {
+    return NULL;
+  }
+  std::copy(values.begin(), values.end(),
+            static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array))));
+  return array;
+}
+
+/**
+ * Call a Python function once with NumPy arrays instead of once per node
+ * @param fcn a Python callable
+ * @param first values of the first argument
+ * @param second values of the second argument (may be nullptr)
+ * @param params extra positional arguments (may be nullptr)
+ * @param kwds keyword arguments (may be nullptr)
+ * @param result an array returned by fcn (a scalar result is broadcast)
+ * @return false if a Python exception is set
+ */
+static bool pyVectorizedCall(PyObject* fcn,
+                             const std::vector<double>& first,
+                             const std::vector<double>* second,
+                             PyObject* params,
+                             PyObject* kwds,
+                             std::vector<double>* result) {
+  const Py_ssize_t nArrays = second ? 2 : 1;
+  const Py_ssize_t nParams = params ? PyTuple_Size(params) : 0;
+  PyObject* argtuple = PyTuple_New(nArrays + nParams);
+  if (!argtuple) {
+    return false;
+  }
+  PyObject* firstArray = pyArrayFromVector(first);
+  if (!firstArray) {
+    Py_DECREF(argtuple);
+    return false;
+  }
+  PyTuple_SET_ITEM(argtuple, 0, firstArray);
+  if (second) {
+    PyObject* secondArray = pyArrayFromVector(*second);
+    if (!secondArray) {
+      Py_DECREF(argtuple);
+      return false;
+    }
+    PyTuple_SET_ITEM(argtuple, 1, secondArray);
+  }
+  for (Py_ssize_t i = 0; i < nParams; ++i) {
+    PyObject* obj = PyTuple_GET_ITEM(params, i);
+    Py_INCREF(obj);
+    PyTuple_SET_ITEM(argtuple, nArrays + i, obj);
+  }
+  PyObject* rv = PyObject_Call(fcn, argtuple, kwds);
+  Py_DECREF(argtuple);
+  if (!rv) {
+    return false;
+  }
+  PyArrayObject* values = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(rv, NPY_FLOAT64, NPY_ARRAY_IN_ARRAY));
+  Py_DECREF(rv);
+  if (!values) {
+    return false;
+  }
+  const npy_intp size = PyArray_SIZE(values);
+  const double* data = static_cast<const double*>(PyArray_DATA(values));
+  result->resize(first.size());
+  if (size == static_cast<npy_intp>(first.size())) {
+    std::copy(data, data + size, result->begin());
+  } else if (size == 1) {
+    std::fill(result->begin(), result->end(), data[0]);
+  } else {
+    Py_DECREF(values);
+    PyErr_SetString(PyExc_ValueError,
+                    "vectorized callable returned an array of a wrong size");
+    return false;
+  }
+  Py_DECREF(values);
+  return true;
+}
+
+/**
+ * Multiply rule weights by a detection efficiency evaluated
+ * with one vectorized call efficiency(x, ecm)
+ * @return false if a Python exception is set
+ */
+static bool pyApplyVectorizedEfficiency(KuraevFadinRule* rule, PyObject* efficiency) {
+  if (!efficiency || rule->x.empty()) {
+    return true;
+  }
+  std::vector<double> eff;
+  if (!pyVectorizedCall(efficiency, rule->x, &(rule->ecm), NULL, NULL, &eff)) {
+    return false;
+  }
+  for (std::size_t k = 0; k < eff.size(); ++k) {
+    rule->weight[k] *= eff[k];
+  }
+  return true;
+}
+
+/**
+ * Prepare a radiator operator for a set of center-of-mass energies
+ * @param n a number of points
+ * @param energy a center-of-mass energy array
+ * @param energyErr a center-of-mass energy spread array (nullptr means no spread)
+ * @param threshold a threshold energy
+ * @param efficiency a vectorized Python efficiency (may be nullptr)
+ * @return a new radiator operator or nullptr if a Python exception is set
+ */
+static RadiatorOperator* pyMakeVectorizedRadiator(std::size_t n,
+                                                  const double* energy,
+                                                  const double* energyErr,
+                                                  double threshold,
+                                                  PyObject* efficiency) {
+  RadiatorOperator* radiator = new RadiatorOperator(threshold);
+  radiator->setPoints(n, energy, energyErr);
+  const KuraevFadinRule& nodes = radiator->getNodes();
+  if (efficiency && !nodes.x.empty()) {
+    std::vector<double> eff;
+    if (!pyVectorizedCall(efficiency, nodes.x, &(nodes.ecm), NULL, NULL, &eff)) {
+      delete radiator;
+      return nullptr;
+    }
+    radiator->scaleNodeWeights(eff);
+  }
+  return radiator;
+}
+
+/**
+ * Evaluate convolutions of all points with one vectorized call
+ * fcn(energy_array, *params, **kwds)
+ * @return false if a Python exception is set
+ */
+static bool pyVectorizedConvolutions(const RadiatorOperator& radiator,
+                                     PyObject* fcn,
+                                     PyObject* params,
+                                     PyObject* kwds,
+                                     std::vector<double>* result) {
+  const KuraevFadinRule& nodes = radiator.getNodes();
+  result->assign(radiator.getEnergies().size(), 0.);
+  if (nodes.energy.empty()) {
+    return true;
+  }
+  std::vector<double> values;
+  if (!pyVectorizedCall(fcn, nodes.energy, NULL, params, kwds, &values)) {
+    return false;
+  }
+  Eigen::VectorXd convolutions;
+  radiator.applyValues(Eigen::Map<const Eigen::VectorXd>(values.data(), values.size()),
+                       &convolutions);
+  std::copy(convolutions.data(), convolutions.data() + convolutions.size(), result->begin());
+  return true;
+}
+
+#endif
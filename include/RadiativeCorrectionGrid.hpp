@@ -0,0 +1,103 @@
+#ifndef _RADIATIVE_CORRECTION_GRID_HPP_
+#define _RADIATIVE_CORRECTION_GRID_HPP_
+#include <exception>
+#include <functional>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "RadiatorOperator.hpp"
+
+/**
+ * Model values do not match the grid or the nodes
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Wrong number of model values.\n";
+  }
+} RadiativeCorrectionGridException;
+
+/**
+ * Radiative correction engine of the iterative solvers that use
+ * a visible cross section fit function. The radiator operator rules of
+ * the fixed energy grid are prepared once, the fit function is evaluated
+ * once at the rule nodes. Each iteration is then reduced to two sparse
+ * matrix-vector products: linear interpolation of the radiative correction
+ * from the grid to the nodes and the radiator operator that maps the Born
+ * cross section at the nodes to the visible cross section at the grid points.
+ */
+class RadiativeCorrectionGrid {
+ public:
+  /**
+   * Constructor
+   * @param radiator a radiator operator with rules prepared (setPoints)
+   * at the grid center-of-mass energies in ascending order
+   */
+  explicit RadiativeCorrectionGrid(const RadiatorOperator& radiator);
+  /**
+   * Grid center-of-mass energies
+   */
+  const Eigen::VectorXd& getEnergies() const;
+  /**
+   * Node energies clamped to the grid range
+   */
+  const std::vector<double>& getNodeEnergies() const;
+  /**
+   * Evaluate the fit function at the nodes and at the grid points.
+   * The function is called sequentially, so it need not be thread-safe.
+   */
+  void setModel(const std::function<double(double)>& fcn);
+  /**
+   * Set fit function values evaluated elsewhere
+   * @param nodeValues values at getNodeEnergies()
+   * @param gridValues values at getEnergies()
+   */
+  void setModelValues(const Eigen::VectorXd& nodeValues,
+                      const Eigen::VectorXd& gridValues);
+  /**
+   * One iteration: the radiative correction at the grid points that
+   * corresponds to the Born cross section fit / (1 + radCorr)
+   * @param radCorr a radiative correction at the grid points
+   * @param result a new radiative correction (NaN values are replaced by 0)
+   */
+  void iterate(const Eigen::VectorXd& radCorr, Eigen::VectorXd* result);
+
+ private:
+  /**
+   * Threshold energy
+   */
+  double _threshold;
+  /**
+   * Grid center-of-mass energies
+   */
+  Eigen::VectorXd _ecm;
+  /**
+   * Node energies clamped to the grid range
+   */
+  std::vector<double> _nodeEnergy;
+  /**
+   * Radiator operator weights (grid points x nodes)
+   */
+  Eigen::SparseMatrix<double, Eigen::RowMajor> _radiator;
+  /**
+   * Linear interpolation operator (nodes x grid points)
+   */
+  Eigen::SparseMatrix<double, Eigen::RowMajor> _interp;
+  /**
+   * Fit function values at the nodes
+   */
+  Eigen::VectorXd _nodeModel;
+  /**
+   * Fit function values at the grid points
+   */
+  Eigen::VectorXd _gridModel;
+  /**
+   * Workspace: Born cross section at the nodes
+   */
+  Eigen::VectorXd _nodeBorn;
+  /**
+   * Workspace: visible cross section at the grid points
+   */
+  Eigen::VectorXd _gridVCS;
+};
+
+#endif
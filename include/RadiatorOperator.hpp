@@ -0,0 +1,142 @@
+#ifndef _RADIATOR_OPERATOR_HPP_
+#define _RADIATOR_OPERATOR_HPP_
+#include <functional>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "KuraevFadin.hpp"
+
+/**
+ * Radiator operator: convolution of a Born cross section with
+ * the Kuraev-Fadin kernel function, a detection efficiency and
+ * a Gaussian center-of-mass energy spread. The operator can be applied
+ * at a single point (adaptive quadrature), to a set of points
+ * (fixed-node rules prepared once by setPoints) or as a sparse matrix
+ * that maps function values on an energy grid to the set of points.
+ */
+class RadiatorOperator {
+ public:
+  /**
+   * Constructor
+   * @param threshold a threshold energy
+   * @param efficiency a detection efficiency
+   */
+  explicit RadiatorOperator(double threshold,
+                            const std::function<double(double, double)>& efficiency =
+                            [](double, double) {return 1.;});
+  /**
+   * Threshold energy
+   */
+  double getThreshold() const;
+  /**
+   * Detection efficiency
+   */
+  const std::function<double(double, double)>& getEfficiency() const;
+  /**
+   * Set energies of narrow peaks of the convoluted functions. The peaks
+   * are used as quadrature breakpoints by the point application and
+   * as panel boundaries by the rules prepared afterwards.
+   */
+  void setPeaks(const std::vector<double>& peaks);
+  /**
+   * Energies of narrow peaks
+   */
+  const std::vector<double>& getPeaks() const;
+  /**
+   * Point application (adaptive quadrature)
+   * @param energy a center-of-mass energy
+   * @param sigma2 a square of center-of-mass energy spread (0 means no spread)
+   * @param fcn a function that is convoluted
+   */
+  double apply(double energy, double sigma2,
+               const std::function<double(double)>& fcn) const;
+  /**
+   * Prepare fixed-node rules of a set of points. The efficiency
+   * is called from several threads if nThreads != 1.
+   * @param n a number of points
+   * @param energy a center-of-mass energy array
+   * @param energyErr a center-of-mass energy spread array (nullptr means no spread)
+   * @param nThreads a number of threads (0 means hardware concurrency)
+   */
+  void setPoints(std::size_t n, const double* energy, const double* energyErr,
+                 std::size_t nThreads = 1);
+  /**
+   * Center-of-mass energies of the points
+   */
+  const Eigen::VectorXd& getEnergies() const;
+  /**
+   * Rule nodes of all points, nodes of the point i are
+   * [getOffsets()[i], getOffsets()[i + 1])
+   */
+  const KuraevFadinRule& getNodes() const;
+  /**
+   * Node offsets of the points
+   */
+  const std::vector<std::size_t>& getOffsets() const;
+  /**
+   * Multiply node weights by factors, for example by a detection
+   * efficiency evaluated at the nodes elsewhere
+   */
+  void scaleNodeWeights(const std::vector<double>& factors);
+  /**
+   * Weight matrix (points x nodes)
+   */
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& getWeights() const;
+  /**
+   * Batch application: fcn is evaluated sequentially at the nodes
+   * @param fcn a function that is convoluted
+   * @param result convolutions at the points
+   */
+  void apply(const std::function<double(double)>& fcn, Eigen::VectorXd* result) const;
+  /**
+   * Batch application to function values at the nodes
+   * @param nodeValues function values at getNodes().energy
+   * @param result convolutions at the points
+   */
+  void applyValues(const Eigen::VectorXd& nodeValues, Eigen::VectorXd* result) const;
+  /**
+   * Linear interpolation from an energy grid to the nodes
+   * (nodes x grid points). Nodes outside the grid use the values
+   * at the grid edges.
+   * @param grid energies in ascending order
+   */
+  Eigen::SparseMatrix<double, Eigen::RowMajor> interpolation(const Eigen::VectorXd& grid) const;
+  /**
+   * Matrix application: convolutions at the points of a function
+   * linearly interpolated between grid values (points x grid points)
+   * @param grid energies in ascending order
+   */
+  Eigen::SparseMatrix<double, Eigen::RowMajor> matrix(const Eigen::VectorXd& grid) const;
+
+ private:
+  /**
+   * Threshold energy
+   */
+  double _threshold;
+  /**
+   * Detection efficiency
+   */
+  std::function<double(double, double)> _efficiency;
+  /**
+   * Energies of narrow peaks
+   */
+  std::vector<double> _peaks;
+  /**
+   * Center-of-mass energies of the points
+   */
+  Eigen::VectorXd _energy;
+  /**
+   * Rule nodes of all points
+   */
+  KuraevFadinRule _nodes;
+  /**
+   * Node offsets of the points
+   */
+  std::vector<std::size_t> _offset;
+  /**
+   * Weight matrix (points x nodes)
+   */
+  Eigen::SparseMatrix<double, Eigen::RowMajor> _weights;
+};
+
+#endif
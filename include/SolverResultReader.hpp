@@ -0,0 +1,60 @@
+#ifndef _SOLVER_RESULT_READER_HPP_
+#define _SOLVER_RESULT_READER_HPP_
+#include <map>
+#include <memory>
+#include <string>
+#include <Eigen/Dense>
+#include "ColumnarIO.hpp"
+
+class TFile;
+
+/**
+ * Reader of solver results (graphs and matrices) written by save().
+ * Binary columnar (.isrbin) files are memory-mapped, so graphs and
+ * matrices are returned without copying. ROOT files are read once per
+ * object without Clone() and converted to the column-major layout.
+ */
+class SolverResultReader {
+ public:
+  /**
+   * Constructor
+   * @param path a path to the .root or .isrbin file
+   */
+  explicit SolverResultReader(const std::string& path);
+  SolverResultReader(const SolverResultReader&) = delete;
+  SolverResultReader& operator=(const SolverResultReader&) = delete;
+  /**
+   * Destructor
+   */
+  ~SolverResultReader();
+  /**
+   * Returns true if the file is memory-mapped
+   */
+  bool isMemoryMapped() const;
+  /**
+   * Graph in a form of n x 4 matrix (x, x error, y, y error)
+   * @param name a graph name
+   */
+  Eigen::Map<const Eigen::MatrixXd> graph(const std::string& name) const;
+  /**
+   * Matrix
+   * @param name a matrix name
+   */
+  Eigen::Map<const Eigen::MatrixXd> matrix(const std::string& name) const;
+
+ private:
+  /**
+   * Memory-mapped binary columnar file
+   */
+  std::unique_ptr<ColumnarFile> _columnar;
+  /**
+   * ROOT file
+   */
+  TFile* _rootFile;
+  /**
+   * Objects loaded from the ROOT file
+   */
+  mutable std::map<std::string, Eigen::MatrixXd> _loaded;
+};
+
+#endif
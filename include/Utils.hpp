@@ -2,6 +2,7 @@
 #define _UTILS_HPP_
 #include <iostream>
 #include <string>
+#include <vector>
 #include <Eigen/Dense>
 #include <TFile.h>
 
@@ -15,4 +16,54 @@ Eigen::VectorXd randomDrawVisCS(const Eigen::VectorXd& vcs,
 
 double lambdaObjective(unsigned n, const double* plambda, double* grad, void* solver);
 
+/**
+ * Write a matrix to the current ROOT directory in a form of TMatrixD
+ * (without a transposed temporary)
+ * @param matrix a matrix
+ * @param name an object name
+ */
+void writeTMatrixD(const Eigen::MatrixXd& matrix, const std::string& name);
+
+/**
+ * Convert a comma-separated list of output products to OutputProduct flags
+ * @param products a list of vcs, bcs, intop, cov, invcov, interp, radcorr,
+ * cost or all
+ */
+unsigned parseOutputProducts(const std::string& products);
+
+/**
+ * Convert a comma-separated list of energies (GeV) to a vector
+ * @param energies a list, for example 0.782,1.019
+ */
+std::vector<double> parseEnergyList(const std::string& energies);
+
+/**
+ * Insert an element into a vector
+ * @param vec a vector
+ * @param index an index of the new element
+ * @param value a value of the new element
+ */
+void insertVectorElement(Eigen::VectorXd* vec, std::size_t index, double value);
+
+/**
+ * Erase an element of a vector
+ * @param vec a vector
+ * @param index an index of the element
+ */
+void eraseVectorElement(Eigen::VectorXd* vec, std::size_t index);
+
+/**
+ * Insert a zero row and a zero column into a square matrix
+ * @param matrix a square matrix
+ * @param index an index of the new row and column
+ */
+void insertMatrixRowCol(Eigen::MatrixXd* matrix, std::size_t index);
+
+/**
+ * Erase a row and a column of a square matrix
+ * @param matrix a square matrix
+ * @param index an index of the row and column
+ */
+void eraseMatrixRowCol(Eigen::MatrixXd* matrix, std::size_t index);
+
 #endif
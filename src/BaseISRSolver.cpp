@@ -1,9 +1,29 @@
 #include <algorithm>
 #include <vector>
 #include <TFile.h>
+#include <TMatrixD.h>
 #include <TH1F.h>
 #include <TH2F.h>
 #include "BaseISRSolver.hpp"
+#include "ColumnarIO.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
+
+namespace {
+/**
+ * Indices of points in ascending order of center-of-mass energy
+ */
+std::vector<std::size_t> ascendingEnergyOrder(std::size_t n, const double* energy) {
+  std::vector<std::size_t> index(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    index[i] = i;
+  }
+  std::stable_sort(index.begin(), index.end(),
+                   [energy](std::size_t i1, std::size_t i2)
+                   { return energy[i1] < energy[i2]; });
+  return index;
+}
+}  // namespace
 
 double* extractECMPointer(BaseISRSolver* solver) {
   return solver->_visibleCSData.cmEnergy.data();
@@ -30,28 +50,43 @@ double* extractBCSPointer(BaseISRSolver* solver) {
  * @param vcsGraph a visible cross section in a form of TGraphErrors
  */
 void BaseISRSolver::setupVCS(TGraphErrors* vcsGraph) {
+  setupVCS(vcsGraph->GetN(), vcsGraph->GetX(), vcsGraph->GetEX(),
+           vcsGraph->GetY(), vcsGraph->GetEY());
+}
+
+/**
+ * Initialize visible cross section data
+ * @param n a number of points
+ * @param energy a center-of-mass energy array
+ * @param energyErr a center-of-mass energy error array
+ * @param vcs a visible cross section array
+ * @param vcsErr a visible cross section error array
+ */
+void BaseISRSolver::setupVCS(std::size_t n,
+                             const double* energy, const double* energyErr,
+                             const double* vcs, const double* vcsErr) {
   /**
    * Initialize number of points
    */
-  _n = vcsGraph->GetN();
+  _n = n;
   std::vector<CSData> visibleCS;
   visibleCS.reserve(_n);
   for (std::size_t i = 0; i < _n; ++i) {
     /**
-     * Load visible cross section data from TGraphErrors object
+     * Load visible cross section data
      */
     visibleCS.push_back(
-        {.cmEnergy = vcsGraph->GetX()[i],
-        .cs = vcsGraph->GetY()[i],
-        .cmEnergyError = vcsGraph->GetEX()[i],
-        .csError = vcsGraph->GetEY()[i]});
+        {.cmEnergy = energy[i],
+        .cs = vcs[i],
+        .cmEnergyError = energyErr[i],
+        .csError = vcsErr[i]});
   }
   /**
    * Sorting a visible cross section data in ascending order of
    center-of-mass energy
    */
-  std::sort(visibleCS.begin(), visibleCS.end(),
-            [](const CSData& x, const CSData& y) { return x.cmEnergy < y.cmEnergy; });
+  std::stable_sort(visibleCS.begin(), visibleCS.end(),
+                   [](const CSData& x, const CSData& y) { return x.cmEnergy < y.cmEnergy; });
   /**
    * Converting sorted visible cross section data to a vector format
    */
@@ -83,7 +118,10 @@ BaseISRSolver::BaseISRSolver(std::size_t numberOfPoints,
     _energyT(thresholdEnergy),
     _n(numberOfPoints),
     _efficiency(efficiency),
-    _tefficiency(nullptr) {
+    _tefficiency(nullptr),
+    _isVCSCovMatrixFull(false),
+    _vcsErrVersion(0),
+    _lastVCSErrUpdateDiagonal(false) {
   Eigen::VectorXd enV(_n);
   Eigen::VectorXd csV(_n);
   Eigen::VectorXd enErrV(_n);
@@ -138,7 +176,10 @@ BaseISRSolver::BaseISRSolver(TGraphErrors* vcsGraph,
     : _energySpread(false),
       _energyT(thresholdEnergy),
       _efficiency([](double, double) {return 1.;}),
-      _tefficiency(std::shared_ptr<TEfficiency>(nullptr)) {
+      _tefficiency(std::shared_ptr<TEfficiency>(nullptr)),
+      _isVCSCovMatrixFull(false),
+      _vcsErrVersion(0),
+      _lastVCSErrUpdateDiagonal(false) {
   /**
    * Initialize a visible cross section data
    */
@@ -178,7 +219,15 @@ BaseISRSolver::BaseISRSolver(const std::string& inputPath,
     _energySpread(false),
     _energyT(inputOpts.thresholdEnergy),
     _efficiency([](double, double) {return 1.;}),
-    _tefficiency(std::shared_ptr<TEfficiency>(nullptr)) {
+    _tefficiency(std::shared_ptr<TEfficiency>(nullptr)),
+    _isVCSCovMatrixFull(false),
+    _vcsErrVersion(0),
+    _lastVCSErrUpdateDiagonal(false) {
+  ISR_PROFILE_SCOPE("readInput");
+  if (isColumnarPath(inputPath)) {
+    _readColumnar(inputPath, inputOpts);
+    return;
+  }
   /**
    * Opening input file that contains a visible cross section and
    detection efficiency
@@ -193,6 +242,23 @@ BaseISRSolver::BaseISRSolver(const std::string& inputPath,
    * Initialize a visible cross section
    */
   setupVCS(vcsGraph);
+  /**
+   * Load a full visible cross section covariance matrix
+   */
+  if (inputOpts.vcsCovMatrixName.length() > 0) {
+    auto covMatrix = dynamic_cast<TMatrixD*>(fl->Get(inputOpts.vcsCovMatrixName.c_str()));
+    if (!covMatrix) {
+      throw VCSCovMatrixException();
+    }
+    /**
+     * TMatrixD keeps elements in row-major order
+     */
+    _setupVCSCovMatrix(
+        vcsGraph->GetX(),
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+            covMatrix->GetMatrixArray(), covMatrix->GetNrows(), covMatrix->GetNcols()));
+    delete covMatrix;
+  }
   /**
    * Load a detection efficiency from the input file
    */
@@ -210,6 +276,51 @@ BaseISRSolver::BaseISRSolver(const std::string& inputPath,
   }
 }
 
+/**
+ * Read a visible cross section and a detection efficiency
+ from a binary columnar file
+ */
+void BaseISRSolver::_readColumnar(const std::string& inputPath,
+                                  const InputOptions& inputOpts) {
+  ColumnarFile fl(inputPath);
+  /**
+   * The graph columns are mapped without copying
+   */
+  const auto vcsGraph = fl.matrix(inputOpts.visibleCSGraphName);
+  if (vcsGraph.cols() != 4) {
+    throw ColumnarFormatException();
+  }
+  setupVCS(vcsGraph.rows(),
+           vcsGraph.col(0).data(), vcsGraph.col(1).data(),
+           vcsGraph.col(2).data(), vcsGraph.col(3).data());
+  if (inputOpts.vcsCovMatrixName.length() > 0) {
+    _setupVCSCovMatrix(vcsGraph.col(0).data(), fl.matrix(inputOpts.vcsCovMatrixName));
+  }
+  if (inputOpts.efficiencyName.length() > 0) {
+    _efficiency = columnarEfficiency(fl, inputOpts.efficiencyName);
+  }
+}
+
+/**
+ * Set a visible cross section covariance matrix that is stored
+ in the order of input points
+ */
+void BaseISRSolver::_setupVCSCovMatrix(const double* energy,
+                                       const Eigen::MatrixXd& covMatrix) {
+  if (covMatrix.rows() != static_cast<Eigen::Index>(_n) ||
+      covMatrix.cols() != static_cast<Eigen::Index>(_n)) {
+    throw VCSCovMatrixException();
+  }
+  const auto index = ascendingEnergyOrder(_n, energy);
+  Eigen::MatrixXd sorted(_n, _n);
+  for (std::size_t j = 0; j < _n; ++j) {
+    for (std::size_t i = 0; i < _n; ++i) {
+      sorted(i, j) = covMatrix(index[i], index[j]);
+    }
+  }
+  setVisibleCSCovMatrix(sorted);
+}
+
 /**
  * Copy constructor
  */
@@ -219,7 +330,21 @@ BaseISRSolver::BaseISRSolver(const BaseISRSolver& solver) :
   _visibleCSData(solver._visibleCSData),
   _efficiency(solver._efficiency),
   _tefficiency(solver._tefficiency),
-  _bornCS(solver._bornCS) {}
+  _bornCS(solver._bornCS),
+  _isVCSCovMatrixFull(solver._isVCSCovMatrixFull),
+  _vcsCovMatrix(solver._vcsCovMatrix),
+  _vcsCovLLT(solver._vcsCovLLT),
+  _vcsErrVersion(solver._vcsErrVersion),
+  _lastVCSErrChanges(solver._lastVCSErrChanges),
+  _lastVCSErrUpdateDiagonal(solver._lastVCSErrUpdateDiagonal) {
+  /**
+   * Rebind the detection efficiency to this object, so that
+   the copy does not depend on the lifetime of the original solver
+   */
+  if (_tefficiency.get()) {
+    _setupEfficiency();
+  }
+}
 
 /**
  * Destructor
@@ -350,10 +475,62 @@ const Eigen::VectorXd& BaseISRSolver::_vcsErr() const {
 Eigen::VectorXd& BaseISRSolver::_vcsErr() { return _visibleCSData.csError; }
 
 /**
- * Visible cross section error getter in a form of covariance matrix
+ * Multiply a matrix by L^-1 (C = L L^T)
+ */
+Eigen::MatrixXd BaseISRSolver::_vcsWhiten(const Eigen::MatrixXd& mx) const {
+  if (_isVCSCovMatrixFull) {
+    return _vcsCovLLT.matrixL().solve(mx);
+  }
+  return (mx.array().colwise() / _visibleCSData.csError.array()).matrix();
+}
+
+/**
+ * Multiply a vector by L^-1 (C = L L^T)
  */
-Eigen::MatrixXd BaseISRSolver::_vcsInvCovMatrix() const {
-  return _visibleCSData.csError.array().pow(-2.).matrix().asDiagonal();
+Eigen::VectorXd BaseISRSolver::_vcsWhiten(const Eigen::VectorXd& vec) const {
+  Eigen::VectorXd result = vec;
+  _vcsWhitenInPlace(&result);
+  return result;
+}
+
+/**
+ * Multiply a vector by L^-1 in place
+ */
+void BaseISRSolver::_vcsWhitenInPlace(Eigen::VectorXd* vec) const {
+  if (_isVCSCovMatrixFull) {
+    _vcsCovLLT.matrixL().solveInPlace(*vec);
+  } else {
+    vec->array() /= _visibleCSData.csError.array();
+  }
+}
+
+/**
+ * Full visible cross section covariance matrix const getter
+ */
+const Eigen::MatrixXd& BaseISRSolver::_getVCSCovMatrix() const {
+  return _vcsCovMatrix;
+}
+
+/**
+ * Version of visible cross section errors
+ */
+std::size_t BaseISRSolver::_getVCSErrVersion() const {
+  return _vcsErrVersion;
+}
+
+/**
+ * Visible cross section errors changed by the last version increment
+ */
+const std::vector<std::pair<std::size_t, double>>&
+BaseISRSolver::_getLastVCSErrChanges() const {
+  return _lastVCSErrChanges;
+}
+
+/**
+ * Returns true if the last version increment changed diagonal weights only
+ */
+bool BaseISRSolver::_isLastVCSErrUpdateDiagonal() const {
+  return _lastVCSErrUpdateDiagonal;
 }
 
 /**
@@ -433,7 +610,117 @@ void BaseISRSolver::resetVisibleCS(const Eigen::VectorXd& vcs) {
  at each center-of-mass energy point.
 */
 void BaseISRSolver::resetVisibleCSErrors(const Eigen::VectorXd& vcsErr) {
+  _lastVCSErrChanges.clear();
+  _lastVCSErrUpdateDiagonal = !_isVCSCovMatrixFull &&
+                              vcsErr.size() == _visibleCSData.csError.size();
+  if (_lastVCSErrUpdateDiagonal) {
+    for (Eigen::Index i = 0; i < vcsErr.size(); ++i) {
+      if (vcsErr(i) != _visibleCSData.csError(i)) {
+        _lastVCSErrChanges.emplace_back(i, _visibleCSData.csError(i));
+      }
+    }
+  }
   _visibleCSData.csError = vcsErr;
+  _isVCSCovMatrixFull = false;
+  _vcsCovMatrix.resize(0, 0);
+  _vcsCovLLT = Eigen::LLT<Eigen::MatrixXd>();
+  ++_vcsErrVersion;
+}
+
+/**
+ * This method is used to set a full visible cross section covariance matrix
+ */
+void BaseISRSolver::setVisibleCSCovMatrix(const Eigen::MatrixXd& covMatrix) {
+  if (covMatrix.rows() != static_cast<Eigen::Index>(_n) ||
+      covMatrix.cols() != static_cast<Eigen::Index>(_n)) {
+    throw VCSCovMatrixException();
+  }
+  _vcsCovLLT.compute(covMatrix);
+  if (_vcsCovLLT.info() != Eigen::Success) {
+    throw VCSCovMatrixException();
+  }
+  _visibleCSData.csError = covMatrix.diagonal().cwiseSqrt();
+  _vcsCovMatrix = covMatrix;
+  _isVCSCovMatrixFull = true;
+  ++_vcsErrVersion;
+  _lastVCSErrChanges.clear();
+  _lastVCSErrUpdateDiagonal = false;
+}
+
+/**
+ * Insert a visible cross section point
+ */
+std::size_t BaseISRSolver::_insertPoint(double energy, double energyErr,
+                                        double vcs, double vcsErr) {
+  const double* first = _visibleCSData.cmEnergy.data();
+  const std::size_t index = std::lower_bound(first, first + _n, energy) - first;
+  if (energy <= _energyT || (index < _n && first[index] == energy)) {
+    throw EnergyPointException();
+  }
+  if (_isVCSCovMatrixFull) {
+    Eigen::MatrixXd covMatrix = _vcsCovMatrix;
+    insertMatrixRowCol(&covMatrix, index);
+    covMatrix(index, index) = vcsErr * vcsErr;
+    _vcsCovLLT.compute(covMatrix);
+    if (_vcsCovLLT.info() != Eigen::Success) {
+      _vcsCovLLT.compute(_vcsCovMatrix);
+      throw VCSCovMatrixException();
+    }
+    _vcsCovMatrix.swap(covMatrix);
+  }
+  insertVectorElement(&_visibleCSData.cmEnergy, index, energy);
+  insertVectorElement(&_visibleCSData.cmEnergyError, index, energyErr);
+  insertVectorElement(&_visibleCSData.cs, index, vcs);
+  insertVectorElement(&_visibleCSData.csError, index, vcsErr);
+  if (_bornCS.size() == static_cast<Eigen::Index>(_n)) {
+    insertVectorElement(&_bornCS, index, 0);
+  }
+  ++_n;
+  ++_vcsErrVersion;
+  _lastVCSErrChanges.clear();
+  _lastVCSErrUpdateDiagonal = false;
+  return index;
+}
+
+/**
+ * Remove a visible cross section point
+ */
+void BaseISRSolver::_erasePoint(std::size_t index) {
+  if (index >= _n || _n == 1) {
+    throw EnergyPointException();
+  }
+  if (_isVCSCovMatrixFull) {
+    eraseMatrixRowCol(&_vcsCovMatrix, index);
+    _vcsCovLLT.compute(_vcsCovMatrix);
+  }
+  eraseVectorElement(&_visibleCSData.cmEnergy, index);
+  eraseVectorElement(&_visibleCSData.cmEnergyError, index);
+  eraseVectorElement(&_visibleCSData.cs, index);
+  eraseVectorElement(&_visibleCSData.csError, index);
+  if (_bornCS.size() == static_cast<Eigen::Index>(_n)) {
+    eraseVectorElement(&_bornCS, index);
+  }
+  --_n;
+  ++_vcsErrVersion;
+  _lastVCSErrChanges.clear();
+  _lastVCSErrUpdateDiagonal = false;
+}
+
+/**
+ * Returns true if a full visible cross section covariance matrix is used
+ */
+bool BaseISRSolver::isVisibleCSCovMatrixFull() const {
+  return _isVCSCovMatrixFull;
+}
+
+/**
+ * Visible cross section covariance matrix getter
+ */
+Eigen::MatrixXd BaseISRSolver::getVisibleCSCovMatrix() const {
+  if (_isVCSCovMatrixFull) {
+    return _vcsCovMatrix;
+  }
+  return _visibleCSData.csError.array().square().matrix().asDiagonal();
 }
 
 /**
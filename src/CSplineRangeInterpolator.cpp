@@ -87,8 +87,12 @@ double CSplineRangeInterpolator::basisDerivEval(
  */
 double CSplineRangeInterpolator::evalKuraevFadinBasisIntegral(
     int energyIndex, int csIndex,
-    const std::function<double(double, double)>& efficiency) const {
+    const std::function<double(double, double)>& efficiency,
+    double* error) const {
   const int index = csIndex - _beginIndex;
+  if (error) {
+    *error = 0;
+  }
   /**
    * Get center-of-mass energy that corresponds to energyIndex
    */
@@ -106,7 +110,7 @@ double CSplineRangeInterpolator::evalKuraevFadinBasisIntegral(
   /**
    * Evaluate Kuraev-Fadin convolution with basis interpolation
    */
-  return convolutionKuraevFadin(en, fcn, x_min, x_max, efficiency);
+  return convolutionKuraevFadin(en, fcn, x_min, x_max, efficiency, {}, error);
 }
 
 double CSplineRangeInterpolator::evalBasisSConvolution(
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ColumnarIO.hpp"
+
+namespace {
+const char columnarMagic[8] = {'I', 'S', 'R', 'B', 'I', 'N', '\0', '\0'};
+const std::uint32_t columnarVersion = 1;
+const std::size_t columnarAlignment = 64;
+
+std::size_t alignOffset(std::size_t offset) {
+  return (offset + columnarAlignment - 1) / columnarAlignment * columnarAlignment;
+}
+
+/**
+ * Binned detection efficiency
+ */
+typedef struct {
+  std::vector<double> xEdges;
+  std::vector<double> energyEdges;
+  Eigen::MatrixXd values;
+} EfficiencyTable;
+
+/**
+ * Bin index or -1 outside edges
+ */
+int findBin(const std::vector<double>& edges, double value) {
+  if (edges.size() < 2 || value < edges.front() || value >= edges.back()) {
+    return -1;
+  }
+  return std::upper_bound(edges.begin(), edges.end(), value) - edges.begin() - 1;
+}
+}  // namespace
+
+static_assert(sizeof(ColumnarHeader) == 64, "wrong binary columnar header size");
+static_assert(sizeof(ColumnarEntry) == 64, "wrong binary columnar entry size");
+
+bool isColumnarPath(const std::string& path) {
+  const std::string ext = ".isrbin";
+  return path.size() >= ext.size() &&
+      path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+void ColumnarWriter::addMatrix(const std::string& name,
+                               const Eigen::MatrixXd& matrix) {
+  std::vector<const double*> columns(matrix.cols());
+  for (Eigen::Index j = 0; j < matrix.cols(); ++j) {
+    columns[j] = matrix.data() + j * matrix.rows();
+  }
+  addColumns(name, matrix.rows(), columns);
+}
+
+void ColumnarWriter::addVector(const std::string& name,
+                               const Eigen::VectorXd& vector) {
+  addColumns(name, vector.size(), {vector.data()});
+}
+
+void ColumnarWriter::addColumns(const std::string& name, std::size_t rows,
+                                const std::vector<const double*>& columns) {
+  if (name.size() >= sizeof(ColumnarEntry::name)) {
+    throw ColumnarFormatException();
+  }
+  _entries.push_back({name, rows, columns});
+}
+
+void ColumnarWriter::addGraph(const std::string& name, std::size_t n,
+                              const double* x, const double* ex,
+                              const double* y, const double* ey) {
+  addColumns(name, n, {x, ex, y, ey});
+}
+
+void ColumnarWriter::write(const std::string& path) const {
+  ColumnarHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, columnarMagic, sizeof(columnarMagic));
+  header.version = columnarVersion;
+  header.nEntries = _entries.size();
+  std::vector<ColumnarEntry> records(_entries.size());
+  std::size_t offset = alignOffset(sizeof(ColumnarHeader) +
+                                   _entries.size() * sizeof(ColumnarEntry));
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    std::memset(&records[i], 0, sizeof(ColumnarEntry));
+    std::strncpy(records[i].name, _entries[i].name.c_str(), sizeof(ColumnarEntry::name) - 1);
+    records[i].offset = offset;
+    records[i].rows = _entries[i].rows;
+    records[i].cols = _entries[i].columns.size();
+    offset = alignOffset(offset + records[i].rows * records[i].cols * sizeof(double));
+  }
+  std::ofstream fl(path, std::ios::binary | std::ios::trunc);
+  if (!fl.is_open()) {
+    throw ColumnarWriteException();
+  }
+  fl.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  fl.write(reinterpret_cast<const char*>(records.data()),
+           records.size() * sizeof(ColumnarEntry));
+  const std::vector<char> padding(columnarAlignment, 0);
+  std::vector<double> zeros;
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    const std::streamoff position = fl.tellp();
+    if (!fl.good() || position < 0) {
+      throw ColumnarWriteException();
+    }
+    fl.write(padding.data(), records[i].offset - static_cast<std::size_t>(position));
+    for (const double* column : _entries[i].columns) {
+      if (!column) {
+        zeros.assign(_entries[i].rows, 0.);
+        column = zeros.data();
+      }
+      fl.write(reinterpret_cast<const char*>(column), _entries[i].rows * sizeof(double));
+    }
+  }
+  fl.close();
+  if (!fl) {
+    throw ColumnarWriteException();
+  }
+}
+
+ColumnarFile::ColumnarFile(const std::string& path) :
+    _data(nullptr), _size(0) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw ColumnarFormatException();
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ColumnarHeader)) {
+    close(fd);
+    throw ColumnarFormatException();
+  }
+  _size = st.st_size;
+  _data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (_data == MAP_FAILED) {
+    _data = nullptr;
+    throw ColumnarFormatException();
+  }
+  const char* bytes = static_cast<const char*>(_data);
+  const ColumnarHeader* header = reinterpret_cast<const ColumnarHeader*>(bytes);
+  if (std::memcmp(header->magic, columnarMagic, sizeof(columnarMagic)) != 0 ||
+      header->version != columnarVersion ||
+      sizeof(ColumnarHeader) + header->nEntries * sizeof(ColumnarEntry) > _size) {
+    munmap(_data, _size);
+    throw ColumnarFormatException();
+  }
+  const ColumnarEntry* records =
+      reinterpret_cast<const ColumnarEntry*>(bytes + sizeof(ColumnarHeader));
+  for (std::uint32_t i = 0; i < header->nEntries; ++i) {
+    const ColumnarEntry& entry = records[i];
+    if (entry.offset % columnarAlignment != 0 ||
+        entry.offset + entry.rows * entry.cols * sizeof(double) > _size) {
+      munmap(_data, _size);
+      throw ColumnarFormatException();
+    }
+    const std::string name(entry.name, strnlen(entry.name, sizeof(entry.name)));
+    _entries[name] = &entry;
+  }
+}
+
+ColumnarFile::~ColumnarFile() {
+  if (_data) {
+    munmap(_data, _size);
+  }
+}
+
+bool ColumnarFile::contains(const std::string& name) const {
+  return _entries.count(name) > 0;
+}
+
+const ColumnarEntry& ColumnarFile::_entry(const std::string& name) const {
+  auto it = _entries.find(name);
+  if (it == _entries.end()) {
+    throw ColumnarEntryException();
+  }
+  return *(it->second);
+}
+
+Eigen::Map<const Eigen::MatrixXd> ColumnarFile::matrix(const std::string& name) const {
+  const ColumnarEntry& entry = _entry(name);
+  return Eigen::Map<const Eigen::MatrixXd>(
+      reinterpret_cast<const double*>(static_cast<const char*>(_data) + entry.offset),
+      entry.rows, entry.cols);
+}
+
+Eigen::Map<const Eigen::VectorXd> ColumnarFile::column(const std::string& name,
+                                                       std::size_t col) const {
+  const ColumnarEntry& entry = _entry(name);
+  if (col >= entry.cols) {
+    throw ColumnarEntryException();
+  }
+  return Eigen::Map<const Eigen::VectorXd>(
+      reinterpret_cast<const double*>(static_cast<const char*>(_data) + entry.offset) +
+      col * entry.rows, entry.rows);
+}
+
+std::vector<std::string> ColumnarFile::names() const {
+  std::vector<std::string> result;
+  for (const auto& entry : _entries) {
+    result.push_back(entry.first);
+  }
+  return result;
+}
+
+std::function<double(double, double)> columnarEfficiency(const ColumnarFile& file,
+                                                         const std::string& name) {
+  auto table = std::make_shared<EfficiencyTable>();
+  table->values = file.matrix(name);
+  const auto energyEdges = file.column(name + "_energyEdges");
+  table->energyEdges.assign(energyEdges.data(), energyEdges.data() + energyEdges.size());
+  if (file.contains(name + "_xEdges")) {
+    const auto xEdges = file.column(name + "_xEdges");
+    table->xEdges.assign(xEdges.data(), xEdges.data() + xEdges.size());
+  }
+  const bool is2D = !table->xEdges.empty();
+  if (table->energyEdges.size() != static_cast<std::size_t>(table->values.cols()) + 1 ||
+      (is2D && table->xEdges.size() != static_cast<std::size_t>(table->values.rows()) + 1) ||
+      (!is2D && table->values.rows() != 1)) {
+    throw ColumnarFormatException();
+  }
+  return [table, is2D](double x, double energy) {
+    const int ie = findBin(table->energyEdges, energy);
+    const int ix = is2D ? findBin(table->xEdges, x) : 0;
+    if (ie < 0 || ix < 0) {
+      return 0.;
+    }
+    return table->values(ix, ie);
+  };
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+#include "EnergyGrid.hpp"
+
+std::vector<double> adaptiveEnergyGrid(
+    double emin, double emax,
+    std::size_t nInitial,
+    double tolerance,
+    std::size_t maxPoints,
+    const std::function<void(const std::vector<double>&, std::vector<double>*)>& fcn) {
+  nInitial = std::max<std::size_t>(nInitial, 2);
+  maxPoints = std::max(maxPoints, nInitial);
+  std::vector<double> grid(nInitial);
+  const double step = (emax - emin) / (nInitial - 1);
+  for (std::size_t i = 0; i < nInitial; ++i) {
+    grid[i] = emin + step * i;
+  }
+  grid.back() = emax;
+  std::vector<double> values;
+  fcn(grid, &values);
+  double scale = 0;
+  for (const double value : values) {
+    scale = std::max(scale, std::fabs(value));
+  }
+  // Intervals whose midpoints are not yet checked
+  std::vector<bool> active(grid.size() - 1, true);
+  std::vector<double> mids;
+  std::vector<double> midValues;
+  while (grid.size() < maxPoints) {
+    mids.clear();
+    for (std::size_t i = 0; i + 1 < grid.size(); ++i) {
+      if (active[i]) {
+        mids.push_back(0.5 * (grid[i] + grid[i + 1]));
+      }
+    }
+    if (mids.empty()) {
+      break;
+    }
+    fcn(mids, &midValues);
+    for (const double value : midValues) {
+      scale = std::max(scale, std::fabs(value));
+    }
+    std::vector<double> newGrid;
+    std::vector<double> newValues;
+    std::vector<bool> newActive;
+    newGrid.reserve(grid.size() + mids.size());
+    newValues.reserve(grid.size() + mids.size());
+    newActive.reserve(grid.size() + mids.size());
+    std::size_t nPoints = grid.size();
+    std::size_t k = 0;
+    for (std::size_t i = 0; i + 1 < grid.size(); ++i) {
+      newGrid.push_back(grid[i]);
+      newValues.push_back(values[i]);
+      if (!active[i]) {
+        newActive.push_back(false);
+        continue;
+      }
+      const double error = std::fabs(midValues[k] - 0.5 * (values[i] + values[i + 1]));
+      if (error > tolerance * scale && nPoints < maxPoints) {
+        newActive.push_back(true);
+        newGrid.push_back(mids[k]);
+        newValues.push_back(midValues[k]);
+        newActive.push_back(true);
+        ++nPoints;
+      } else {
+        newActive.push_back(false);
+      }
+      ++k;
+    }
+    newGrid.push_back(grid.back());
+    newValues.push_back(values.back());
+    if (newGrid.size() == grid.size()) {
+      break;
+    }
+    grid.swap(newGrid);
+    values.swap(newValues);
+    active.swap(newActive);
+  }
+  return grid;
+}
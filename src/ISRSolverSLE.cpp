@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <boost/lexical_cast.hpp>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <set>
@@ -13,8 +14,12 @@
 #include <Eigen/Core>
 #include <Eigen/SVD>
 
+#include "ColumnarIO.hpp"
 #include "Integration.hpp"
 #include "KuraevFadin.hpp"
+#include "NoMallocCheck.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
 
 double* extractIntOpMatrix(ISRSolverSLE* solver) {
   return solver->_integralOperatorMatrix.data();
@@ -36,33 +41,85 @@ ISRSolverSLE::ISRSolverSLE(std::size_t numberOfPoints,
                   thresholdEnergy,
                   efficiency),
     _interp(Interpolator(ecm(), getThresholdEnergy())),
-    _isEqMatrixPrepared(false) {}
+    _isEqMatrixPrepared(false),
+    _isCostRecordingEnabled(false),
+    _isErrorControlledAssemblyEnabled(false),
+    _assemblyPrecision(0.1),
+    _isIncrementalUpdatesEnabled(false),
+    _isInvCovMatrixBornCSPrepared(false),
+    _isIntOpPseudoInversePrepared(false),
+    _isCovMatrixBornCSPrepared(false),
+    _covMatrixVCSErrVersion(0),
+    _nCovMatrixLowRankUpdates(0) {}
 
 ISRSolverSLE::ISRSolverSLE(TGraphErrors* vcsGraph,
                            double thresholdEnergy) :
     BaseISRSolver(vcsGraph, thresholdEnergy),
     _interp(Interpolator(ecm(), getThresholdEnergy())),
-    _isEqMatrixPrepared(false) {}
+    _isEqMatrixPrepared(false),
+    _isCostRecordingEnabled(false),
+    _isErrorControlledAssemblyEnabled(false),
+    _assemblyPrecision(0.1),
+    _isIncrementalUpdatesEnabled(false),
+    _isInvCovMatrixBornCSPrepared(false),
+    _isIntOpPseudoInversePrepared(false),
+    _isCovMatrixBornCSPrepared(false),
+    _covMatrixVCSErrVersion(0),
+    _nCovMatrixLowRankUpdates(0) {}
 
 ISRSolverSLE::ISRSolverSLE(TGraphErrors* vcsGraph,
                            TEfficiency* eff,
                            double thresholdEnergy) :
     BaseISRSolver(vcsGraph, eff, thresholdEnergy),
     _interp(Interpolator(ecm(), getThresholdEnergy())),
-    _isEqMatrixPrepared(false) {}
+    _isEqMatrixPrepared(false),
+    _isCostRecordingEnabled(false),
+    _isErrorControlledAssemblyEnabled(false),
+    _assemblyPrecision(0.1),
+    _isIncrementalUpdatesEnabled(false),
+    _isInvCovMatrixBornCSPrepared(false),
+    _isIntOpPseudoInversePrepared(false),
+    _isCovMatrixBornCSPrepared(false),
+    _covMatrixVCSErrVersion(0),
+    _nCovMatrixLowRankUpdates(0) {}
 
 ISRSolverSLE::ISRSolverSLE(const std::string& inputPath,
                              const InputOptions& inputOpts) :
     BaseISRSolver(inputPath, inputOpts),
     _interp(Interpolator(ecm(), getThresholdEnergy())),
-    _isEqMatrixPrepared(false) {}
+    _isEqMatrixPrepared(false),
+    _isCostRecordingEnabled(false),
+    _isErrorControlledAssemblyEnabled(false),
+    _assemblyPrecision(0.1),
+    _isIncrementalUpdatesEnabled(false),
+    _isInvCovMatrixBornCSPrepared(false),
+    _isIntOpPseudoInversePrepared(false),
+    _isCovMatrixBornCSPrepared(false),
+    _covMatrixVCSErrVersion(0),
+    _nCovMatrixLowRankUpdates(0) {}
 
 ISRSolverSLE::ISRSolverSLE(const ISRSolverSLE& solver) :
   BaseISRSolver::BaseISRSolver(solver),
   _interp(solver._interp),
   _isEqMatrixPrepared(solver._isEqMatrixPrepared),
+  _isCostRecordingEnabled(solver._isCostRecordingEnabled),
+  _integralOperatorCost(solver._integralOperatorCost),
+  _isErrorControlledAssemblyEnabled(solver._isErrorControlledAssemblyEnabled),
+  _assemblyPrecision(solver._assemblyPrecision),
+  _integralOperatorErrors(solver._integralOperatorErrors),
+  _isIncrementalUpdatesEnabled(solver._isIncrementalUpdatesEnabled),
+  _kernelMatrix(solver._kernelMatrix),
+  _kernelErrors(solver._kernelErrors),
+  _spreadMatrix(solver._spreadMatrix),
   _integralOperatorMatrix(solver._integralOperatorMatrix),
   _covMatrixBornCS(solver._covMatrixBornCS),
+  _invCovMatrixBornCS(solver._invCovMatrixBornCS),
+  _isInvCovMatrixBornCSPrepared(solver._isInvCovMatrixBornCSPrepared),
+  _intOpPseudoInverse(solver._intOpPseudoInverse),
+  _isIntOpPseudoInversePrepared(solver._isIntOpPseudoInversePrepared),
+  _isCovMatrixBornCSPrepared(solver._isCovMatrixBornCSPrepared),
+  _covMatrixVCSErrVersion(solver._covMatrixVCSErrVersion),
+  _nCovMatrixLowRankUpdates(solver._nCovMatrixLowRankUpdates),
   _dotProdOp(solver._dotProdOp) {}
 
 ISRSolverSLE::~ISRSolverSLE() {}
@@ -75,11 +132,21 @@ const Eigen::MatrixXd& ISRSolverSLE::getBornCSCovMatrix() const {
   return _covMatrixBornCS;
 }
 
+const Eigen::MatrixXd& ISRSolverSLE::getBornCSInvCovMatrix() const {
+  if (!_isInvCovMatrixBornCSPrepared) {
+    _invCovMatrixBornCS = _covMatrixBornCS.inverse();
+    _isInvCovMatrixBornCSPrepared = true;
+  }
+  return _invCovMatrixBornCS;
+}
+
 Eigen::MatrixXd& ISRSolverSLE::_getIntegralOperatorMatrix() {
   return _integralOperatorMatrix;
 }
 
 Eigen::MatrixXd& ISRSolverSLE::_getBornCSCovMatrix() {
+  _isInvCovMatrixBornCSPrepared = false;
+  _isCovMatrixBornCSPrepared = false;
   return _covMatrixBornCS;
 }
 
@@ -88,37 +155,114 @@ void ISRSolverSLE::solve() {
     evalEqMatrix();
     _isEqMatrixPrepared = true;
   }
-  _bcs() =
-      _integralOperatorMatrix.completeOrthogonalDecomposition().solve(_vcs());
-  _covMatrixBornCS = (_integralOperatorMatrix.transpose() *
-                      _vcsInvCovMatrix() * _integralOperatorMatrix).inverse();
+  /**
+   * The pseudo-inverse and the covariance matrix are kept between calls,
+   so that repeated solutions with new visible cross section values
+   (toy Monte Carlo) cost one matrix-vector product
+   */
+  if (!_isIntOpPseudoInversePrepared) {
+    ISR_PROFILE_SCOPE("SLE.decomposition");
+    _intOpPseudoInverse =
+        _integralOperatorMatrix.completeOrthogonalDecomposition().pseudoInverse();
+    _isIntOpPseudoInversePrepared = true;
+  }
+  if (!_isCovMatrixBornCSPrepared ||
+      (_covMatrixVCSErrVersion != _getVCSErrVersion() &&
+       !_updateBornCSCovMatrixLowRank())) {
+    ISR_PROFILE_SCOPE("SLE.covariance");
+    const Eigen::MatrixXd mWA = _vcsWhiten(_integralOperatorMatrix);
+    _covMatrixBornCS = (mWA.transpose() * mWA).inverse();
+    _isInvCovMatrixBornCSPrepared = false;
+    _isCovMatrixBornCSPrepared = true;
+    _covMatrixVCSErrVersion = _getVCSErrVersion();
+    _nCovMatrixLowRankUpdates = 0;
+  }
+  ISR_PROFILE_SCOPE("SLE.solve");
+  ISR_NO_MALLOC_SCOPE(_bcs().size() == static_cast<Eigen::Index>(_getN()));
+  _bcs().noalias() = _intOpPseudoInverse * _vcs();
+}
+
+bool ISRSolverSLE::_updateBornCSCovMatrixLowRank() {
+  const auto& changes = _getLastVCSErrChanges();
+  /**
+   * Each rank-1 update costs a few N^2 operations, so the re-inversion
+   is cheaper if more than ~N/8 points are changed. Rounding errors of
+   the updates accumulate, so the matrix is evaluated from scratch after
+   N updates, which keeps the amortized cost O(N^2) per update.
+   */
+  if (!_isCovMatrixBornCSPrepared || !_isLastVCSErrUpdateDiagonal() ||
+      _covMatrixVCSErrVersion + 1 != _getVCSErrVersion() ||
+      8 * changes.size() > _getN() ||
+      _nCovMatrixLowRankUpdates + changes.size() > _getN()) {
+    return false;
+  }
+  ISR_PROFILE_SCOPE("SLE.covarianceUpdate");
+  /**
+   * C^-1 = A^T W A, where W = diag(1 / vcsErr^2). A change of the weight
+   of the point i by delta gives C'^-1 = C^-1 + delta a a^T, a is the row
+   i of the integral operator matrix, and C' = C - delta / (1 + delta a^T C a)
+   (C a) (C a)^T
+   */
+  for (const auto& change : changes) {
+    const std::size_t i = change.first;
+    const double delta = 1. / (_vcsErr()(i) * _vcsErr()(i)) -
+                         1. / (change.second * change.second);
+    const Eigen::VectorXd a = _integralOperatorMatrix.row(i).transpose();
+    const Eigen::VectorXd u = _covMatrixBornCS * a;
+    const double den = 1. + delta * a.dot(u);
+    if (!std::isfinite(delta) || !(den > 1.e-8)) {
+      return false;
+    }
+    _covMatrixBornCS.noalias() -= (delta / den) * u * u.transpose();
+    if (_isInvCovMatrixBornCSPrepared) {
+      _invCovMatrixBornCS.noalias() += delta * a * a.transpose();
+    }
+  }
+  _covMatrixVCSErrVersion = _getVCSErrVersion();
+  _nCovMatrixLowRankUpdates += changes.size();
+  return true;
 }
 
 void ISRSolverSLE::save(const std::string& outputPath,
                          const OutputOptions& outputOpts) {
-  TGraphErrors vcs(_getN(), _ecm().data(), _vcs().data(), _ecmErr().data(),
-                   _vcsErr().data());
-  TGraphErrors bcs(_getN(), _ecm().data(), _bcs().data(), 0, _bcsErr().data());
-  TMatrixD intergalOperatorMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpIntOpM = _integralOperatorMatrix.transpose();
-  intergalOperatorMatrix.SetMatrixArray(tmpIntOpM.data());
-  TMatrixD bornCSCovMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpCovM = _covMatrixBornCS.transpose();
-  bornCSCovMatrix.SetMatrixArray(tmpCovM.data());
-  TMatrixD bornCSInvCovMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpInvCovM = _covMatrixBornCS.inverse().transpose();
-  bornCSInvCovMatrix.SetMatrixArray(tmpInvCovM.data());
-  auto f0 = _createInterpFunction();
+  ISR_PROFILE_SCOPE("SLE.save");
+  if (isColumnarPath(outputPath)) {
+    const Eigen::VectorXd bcsErr = _bcsErr();
+    ColumnarWriter writer;
+    _addColumnarEntries(&writer, outputOpts, bcsErr);
+    writer.write(outputPath);
+    return;
+  }
+  const unsigned products = outputOpts.products;
   auto fl = TFile::Open(outputPath.c_str(), "recreate");
   fl->cd();
-  vcs.Write(outputOpts.visibleCSGraphName.c_str());
-  bcs.Write(outputOpts.bornCSGraphName.c_str());
-  intergalOperatorMatrix.Write("intergalOperatorMatrix");
-  bornCSCovMatrix.Write("covMatrixBornCS");
-  bornCSInvCovMatrix.Write("invCovMatrixBornCS");
-  f0->Write();
+  if (products & OutputVisibleCS) {
+    TGraphErrors vcs(_getN(), _ecm().data(), _vcs().data(), _ecmErr().data(),
+                     _vcsErr().data());
+    vcs.Write(outputOpts.visibleCSGraphName.c_str());
+  }
+  if (products & OutputBornCS) {
+    TGraphErrors bcs(_getN(), _ecm().data(), _bcs().data(), 0, _bcsErr().data());
+    bcs.Write(outputOpts.bornCSGraphName.c_str());
+  }
+  if (products & OutputIntegralOperatorMatrix) {
+    writeTMatrixD(_integralOperatorMatrix, "intergalOperatorMatrix");
+  }
+  if (products & OutputBornCSCovMatrix) {
+    writeTMatrixD(_covMatrixBornCS, "covMatrixBornCS");
+  }
+  if (products & OutputBornCSInvCovMatrix) {
+    writeTMatrixD(getBornCSInvCovMatrix(), "invCovMatrixBornCS");
+  }
+  if (products & OutputIntegralOperatorCost) {
+    _writeIntegralOperatorCost();
+  }
+  if (products & OutputInterpFunction) {
+    auto f0 = _createInterpFunction();
+    f0->Write();
+    delete f0;
+  }
   fl->Close();
-  delete f0;
   delete fl;
 }
 
@@ -136,18 +280,211 @@ void ISRSolverSLE::setRangeInterpSettings(const std::string& pathToJSON) {
 }
 
 void ISRSolverSLE::evalEqMatrix() {
-  _integralOperatorMatrix = Eigen::MatrixXd::Zero(_getN(), _getN());
-  // TO DO: optimize
+  ISR_PROFILE_SCOPE("evalEqMatrix");
+  _kernelMatrix = Eigen::MatrixXd::Zero(_getN(), _getN());
+  if (_isErrorControlledAssemblyEnabled) {
+    _kernelErrors = Eigen::MatrixXd::Zero(_getN(), _getN());
+  } else {
+    _kernelErrors.resize(0, 0);
+  }
+  if (_isCostRecordingEnabled) {
+    _evalEqMatrixRecordingCost();
+  } else {
+    // TO DO: optimize
+    for (std::size_t j = 0; j < _getN(); ++j) {
+      for(std::size_t i = 0; i < _getN(); ++i) {
+        _kernelMatrix(i, j) = _evalEqMatrixElement(i, j);
+      }
+    }
+  }
+  if (isEnergySpreadEnabled()) {
+    _spreadMatrix = _energySpreadMatrix();
+  } else {
+    _spreadMatrix.resize(0, 0);
+  }
+  _applyEnergySpread();
+  _isIntOpPseudoInversePrepared = false;
+  _isCovMatrixBornCSPrepared = false;
+}
+
+void ISRSolverSLE::_evalEqMatrixRecordingCost() {
+  _integralOperatorCost.evaluations = Eigen::MatrixXd::Zero(_getN(), _getN());
+  _integralOperatorCost.intervals = Eigen::MatrixXd::Zero(_getN(), _getN());
+  _integralOperatorCost.seconds = Eigen::MatrixXd::Zero(_getN(), _getN());
   for (std::size_t j = 0; j < _getN(); ++j) {
     for(std::size_t i = 0; i < _getN(); ++i) {
-      _integralOperatorMatrix(i, j) = _interp.evalKuraevFadinBasisIntegral(i, j, efficiency());
+      resetIntegrationStats();
+      const auto start = std::chrono::steady_clock::now();
+      _kernelMatrix(i, j) = _evalEqMatrixElement(i, j);
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      const IntegrationStats stats = integrationStats();
+      _integralOperatorCost.evaluations(i, j) = stats.evaluations;
+      _integralOperatorCost.intervals(i, j) = stats.intervals;
+      _integralOperatorCost.seconds(i, j) = elapsed.count();
     }
   }
-  if (isEnergySpreadEnabled()) {
-    _integralOperatorMatrix =  _energySpreadMatrix() * _integralOperatorMatrix;
+}
+
+double ISRSolverSLE::_evalEqMatrixElement(std::size_t i, std::size_t j) {
+  IntegrationToleranceScope tolerance(_assemblyTolerance(i));
+  double error = 0;
+  const double result = _interp.evalKuraevFadinBasisIntegral(i, j, efficiency(), &error);
+  if (_kernelErrors.size() > 0) {
+    _kernelErrors(i, j) = error;
+  }
+  return result;
+}
+
+void ISRSolverSLE::_applyEnergySpread() {
+  if (isEnergySpreadEnabled() && _spreadMatrix.size() > 0) {
+    _integralOperatorMatrix.noalias() = _spreadMatrix * _kernelMatrix;
+  } else {
+    _integralOperatorMatrix = _kernelMatrix;
+  }
+  if (_kernelErrors.size() == 0) {
+    _integralOperatorErrors.resize(0, 0);
+  } else if (isEnergySpreadEnabled() && _spreadMatrix.size() > 0) {
+    _integralOperatorErrors.noalias() = _spreadMatrix.cwiseAbs() * _kernelErrors;
+  } else {
+    _integralOperatorErrors = _kernelErrors;
+  }
+  if (!_isIncrementalUpdatesEnabled) {
+    _kernelMatrix.resize(0, 0);
+    _kernelErrors.resize(0, 0);
+    _spreadMatrix.resize(0, 0);
   }
 }
 
+double ISRSolverSLE::_assemblyTolerance(std::size_t i) const {
+  if (!_isErrorControlledAssemblyEnabled) {
+    return integrationTolerance();
+  }
+  const double tolerance = _assemblyPrecision * _vcsErr()(i) / std::abs(_vcs()(i));
+  if (std::isnan(tolerance)) {
+    return integrationTolerance();
+  }
+  return std::min(std::max(tolerance, 1.e-12), 1.e-3);
+}
+
+void ISRSolverSLE::_writeIntegralOperatorCost() const {
+  if (_isErrorControlledAssemblyEnabled && _integralOperatorErrors.size() > 0) {
+    writeTMatrixD(_integralOperatorErrors, "integralOperatorErrors");
+  }
+  if (!_isCostRecordingEnabled || _integralOperatorCost.seconds.size() == 0) {
+    return;
+  }
+  writeTMatrixD(_integralOperatorCost.evaluations, "integralOperatorEvaluations");
+  writeTMatrixD(_integralOperatorCost.intervals, "integralOperatorIntervals");
+  writeTMatrixD(_integralOperatorCost.seconds, "integralOperatorSeconds");
+}
+
+void ISRSolverSLE::_addColumnarEntries(ColumnarWriter* writer,
+                                       const OutputOptions& outputOpts,
+                                       const Eigen::VectorXd& bcsErr) const {
+  const unsigned products = outputOpts.products;
+  if (products & OutputVisibleCS) {
+    writer->addGraph(outputOpts.visibleCSGraphName, _getN(),
+                     ecm().data(), ecmErr().data(), vcs().data(), vcsErr().data());
+  }
+  if (products & OutputBornCS) {
+    writer->addGraph(outputOpts.bornCSGraphName, _getN(),
+                     ecm().data(), nullptr, bcs().data(), bcsErr.data());
+  }
+  if (products & OutputIntegralOperatorMatrix) {
+    writer->addMatrix("intergalOperatorMatrix", _integralOperatorMatrix);
+  }
+  if (products & OutputBornCSCovMatrix) {
+    writer->addMatrix("covMatrixBornCS", _covMatrixBornCS);
+  }
+  if (products & OutputBornCSInvCovMatrix) {
+    writer->addMatrix("invCovMatrixBornCS", getBornCSInvCovMatrix());
+  }
+  if ((products & OutputIntegralOperatorCost) &&
+      _isErrorControlledAssemblyEnabled && _integralOperatorErrors.size() > 0) {
+    writer->addMatrix("integralOperatorErrors", _integralOperatorErrors);
+  }
+  if ((products & OutputIntegralOperatorCost) &&
+      _isCostRecordingEnabled && _integralOperatorCost.seconds.size() > 0) {
+    writer->addMatrix("integralOperatorEvaluations", _integralOperatorCost.evaluations);
+    writer->addMatrix("integralOperatorIntervals", _integralOperatorCost.intervals);
+    writer->addMatrix("integralOperatorSeconds", _integralOperatorCost.seconds);
+  }
+}
+
+void ISRSolverSLE::enableCostRecording() {
+  _isCostRecordingEnabled = true;
+}
+
+void ISRSolverSLE::disableCostRecording() {
+  _isCostRecordingEnabled = false;
+}
+
+bool ISRSolverSLE::isCostRecordingEnabled() const {
+  return _isCostRecordingEnabled;
+}
+
+const IntegralOperatorCost& ISRSolverSLE::getIntegralOperatorCost() const {
+  return _integralOperatorCost;
+}
+
+void ISRSolverSLE::enableErrorControlledAssembly(double precision) {
+  _isErrorControlledAssemblyEnabled = true;
+  _assemblyPrecision = precision;
+  _isEqMatrixPrepared = false;
+}
+
+void ISRSolverSLE::disableErrorControlledAssembly() {
+  _isErrorControlledAssemblyEnabled = false;
+  _isEqMatrixPrepared = false;
+}
+
+bool ISRSolverSLE::isErrorControlledAssemblyEnabled() const {
+  return _isErrorControlledAssemblyEnabled;
+}
+
+void ISRSolverSLE::enableIncrementalUpdates() {
+  if (!_isIncrementalUpdatesEnabled) {
+    _isIncrementalUpdatesEnabled = true;
+    // The kernel matrix is not kept, so it is evaluated again by solve()
+    _isEqMatrixPrepared = false;
+  }
+}
+
+void ISRSolverSLE::disableIncrementalUpdates() {
+  _isIncrementalUpdatesEnabled = false;
+  _kernelMatrix.resize(0, 0);
+  _kernelErrors.resize(0, 0);
+  _spreadMatrix.resize(0, 0);
+}
+
+bool ISRSolverSLE::isIncrementalUpdatesEnabled() const {
+  return _isIncrementalUpdatesEnabled;
+}
+
+const Eigen::MatrixXd& ISRSolverSLE::getIntegralOperatorErrorMatrix() const {
+  return _integralOperatorErrors;
+}
+
+double ISRSolverSLE::evalIntegralOperatorErrorBound() const {
+  if (_integralOperatorErrors.rows() != static_cast<Eigen::Index>(_getN())) {
+    return 0;
+  }
+  const Eigen::VectorXd rowErrors = _integralOperatorErrors * bcs().cwiseAbs();
+  double result = 0;
+  for (std::size_t i = 0; i < _getN(); ++i) {
+    if (_vcsErr()(i) > 0) {
+      result = std::max(result, rowErrors(i) / _vcsErr()(i));
+    }
+  }
+  return result;
+}
+
+void ISRSolverSLE::printIntegralOperatorErrorBound() const {
+  std::cout << "integral operator error bound = " << evalIntegralOperatorErrorBound()
+            << " (in units of visible cross section errors)" << std::endl;
+}
+
 TF1* ISRSolverSLE::_createInterpFunction() const {
   std::function<double(double*, double*)> fcn = [this](double* x, double* par) {
     double result = this->_interp.eval(this->bcs(), x[0]);
@@ -175,21 +512,120 @@ const Eigen::RowVectorXd& ISRSolverSLE::_getDotProdOp() const {
 }
 
 Eigen::MatrixXd ISRSolverSLE::_energySpreadMatrix() const {
+  ISR_PROFILE_SCOPE("energySpreadMatrix");
   Eigen::MatrixXd result = Eigen::MatrixXd::Zero(_getN(), _getN());
-  std::size_t i;
-  std::size_t j;
+  for (std::size_t i = 0; i < _getN(); ++i) {
+    for (std::size_t j = 0; j < _getN(); ++j) {
+      result(i, j) = _energySpreadMatrixElement(i, j);
+    }
+  }
+  return result;
+}
+
+double ISRSolverSLE::_energySpreadMatrixElement(std::size_t i, std::size_t j) const {
   std::function<double(double)> fcn =
-      [&j, this](double energy) {
+      [j, this](double energy) {
         double result = this->_interp.basisEval(j, energy);
         return result;
       };
-  for (i = 0; i < _getN(); ++i) {
-    for (j = 0; j < _getN(); ++j) {
-      double sigma2 = std::pow(this->_ecmErr(i), 2);
-      result(i, j) = gaussian_conv(this->_ecm(i), sigma2, fcn);
+  double sigma2 = std::pow(this->_ecmErr(i), 2);
+  return gaussian_conv(this->_ecm(i), sigma2, fcn);
+}
+
+std::size_t ISRSolverSLE::addPoint(double energy, double energyErr,
+                                   double vcs, double vcsErr) {
+  ISR_PROFILE_SCOPE("SLE.addPoint");
+  const auto settings = _interp.getRangeInterpSettings();
+  const std::size_t index = _insertPoint(energy, energyErr, vcs, vcsErr);
+  _interp = Interpolator(
+      Interpolator::insertPointRangeInterpSettings(settings, index, _getN() - 1),
+      ecm(), getThresholdEnergy());
+  if (!_isIncrementalUpdatesEnabled) {
+    _isEqMatrixPrepared = false;
+  } else if (_isEqMatrixPrepared) {
+    _updateOperators(index, true, _interp.getDependentCSIndices(index));
+  }
+  return index;
+}
+
+void ISRSolverSLE::removePoint(std::size_t index) {
+  ISR_PROFILE_SCOPE("SLE.removePoint");
+  const auto settings = _interp.getRangeInterpSettings();
+  _erasePoint(index);
+  _interp = Interpolator(
+      Interpolator::erasePointRangeInterpSettings(settings, index, _getN() + 1),
+      ecm(), getThresholdEnergy());
+  if (!_isIncrementalUpdatesEnabled) {
+    _isEqMatrixPrepared = false;
+  } else if (_isEqMatrixPrepared) {
+    /**
+     * The neighbours of the removed point have the indices
+     index - 1 and index in the new numbering
+     */
+    _updateOperators(index, false, _interp.getDependentCSIndices(index));
+  }
+}
+
+void ISRSolverSLE::_updateOperators(std::size_t index, bool inserted,
+                                    const std::vector<int>& columns) {
+  ISR_PROFILE_SCOPE("SLE.updateOperators");
+  const std::size_t n = _getN();
+  const std::size_t nPrev = inserted ? n - 1 : n + 1;
+  auto resize = [index, inserted](Eigen::MatrixXd* matrix) {
+    if (inserted) {
+      insertMatrixRowCol(matrix, index);
+    } else {
+      eraseMatrixRowCol(matrix, index);
     }
+  };
+  resize(&_kernelMatrix);
+  if (_kernelErrors.size() > 0) {
+    resize(&_kernelErrors);
   }
-  return result;
+  std::vector<bool> isColumnUpdated(n, false);
+  for (const int j : columns) {
+    isColumnUpdated[j] = true;
+    for (std::size_t i = 0; i < n; ++i) {
+      _kernelMatrix(i, j) = _evalEqMatrixElement(i, j);
+    }
+  }
+  if (inserted) {
+    for (std::size_t j = 0; j < n; ++j) {
+      if (!isColumnUpdated[j]) {
+        _kernelMatrix(index, j) = _evalEqMatrixElement(index, j);
+      }
+    }
+  }
+  if (!isEnergySpreadEnabled()) {
+    _spreadMatrix.resize(0, 0);
+  } else if (_spreadMatrix.rows() != static_cast<Eigen::Index>(nPrev)) {
+    _spreadMatrix = _energySpreadMatrix();
+  } else {
+    resize(&_spreadMatrix);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        if (isColumnUpdated[j] || (inserted && i == index)) {
+          _spreadMatrix(i, j) = _energySpreadMatrixElement(i, j);
+        }
+      }
+    }
+  }
+  _applyEnergySpread();
+  if (_dotProdOp.size() == static_cast<Eigen::Index>(nPrev)) {
+    Eigen::VectorXd dotProdOp = _dotProdOp.transpose();
+    if (inserted) {
+      insertVectorElement(&dotProdOp, index, 0);
+    } else {
+      eraseVectorElement(&dotProdOp, index);
+    }
+    for (const int j : columns) {
+      dotProdOp(j) = _interp.evalIntegralBasis(j);
+    }
+    _dotProdOp = dotProdOp.transpose();
+  }
+  _integralOperatorCost = IntegralOperatorCost();
+  _isIntOpPseudoInversePrepared = false;
+  _isCovMatrixBornCSPrepared = false;
 }
 
 double ISRSolverSLE::interpEval(const Eigen::VectorXd& y,
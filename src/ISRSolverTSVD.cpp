@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <iostream>
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include "ISRSolverTSVD.hpp"
+#include "NoMallocCheck.hpp"
+#include "Profiler.hpp"
 
 ISRSolverTSVD::ISRSolverTSVD(
     std::size_t numberOfPoints,
@@ -16,14 +19,24 @@ ISRSolverTSVD::ISRSolverTSVD(
                  thresholdEnergy,
                  efficiency),
     _upperTSVDIndex(numberOfPoints),
-    _keepOne(false) {}
+    _keepOne(false),
+    _isSVDPrepared(false),
+    _isTSVDCovMatrixPrepared(false),
+    _covFirstIndex(0),
+    _covNHarmonics(0),
+    _covVCSErrVersion(0) {}
 
 ISRSolverTSVD::ISRSolverTSVD(TGraphErrors* vcsGraph,
                              double thresholdEnergy,
                              int upperTSVDIndex) :
     ISRSolverSLE(vcsGraph, thresholdEnergy),
     _upperTSVDIndex(upperTSVDIndex),
-    _keepOne(false) {}
+    _keepOne(false),
+    _isSVDPrepared(false),
+    _isTSVDCovMatrixPrepared(false),
+    _covFirstIndex(0),
+    _covNHarmonics(0),
+    _covVCSErrVersion(0) {}
 
 ISRSolverTSVD::ISRSolverTSVD(TGraphErrors* vcsGraph,
                              TEfficiency* eff,
@@ -31,14 +44,24 @@ ISRSolverTSVD::ISRSolverTSVD(TGraphErrors* vcsGraph,
                              int upperTSVDIndex) :
     ISRSolverSLE(vcsGraph, eff, thresholdEnergy),
     _upperTSVDIndex(upperTSVDIndex),
-    _keepOne(false) {}
+    _keepOne(false),
+    _isSVDPrepared(false),
+    _isTSVDCovMatrixPrepared(false),
+    _covFirstIndex(0),
+    _covNHarmonics(0),
+    _covVCSErrVersion(0) {}
 
 ISRSolverTSVD::ISRSolverTSVD(const std::string& inputPath,
                              const InputOptions& inputOpts,
                              int upperTSVDIndex) :
     ISRSolverSLE(inputPath, inputOpts),
     _upperTSVDIndex(upperTSVDIndex),
-    _keepOne(false) {}
+    _keepOne(false),
+    _isSVDPrepared(false),
+    _isTSVDCovMatrixPrepared(false),
+    _covFirstIndex(0),
+    _covNHarmonics(0),
+    _covVCSErrVersion(0) {}
 
 ISRSolverTSVD::ISRSolverTSVD(const ISRSolverTSVD& solver):
     ISRSolverSLE::ISRSolverSLE(solver),
@@ -46,7 +69,12 @@ ISRSolverTSVD::ISRSolverTSVD(const ISRSolverTSVD& solver):
     _keepOne(solver._keepOne),
     _mU(solver._mU),
     _mV(solver._mV),
-    _mSing(solver._mSing) {}
+    _mSing(solver._mSing),
+    _isSVDPrepared(solver._isSVDPrepared),
+    _isTSVDCovMatrixPrepared(solver._isTSVDCovMatrixPrepared),
+    _covFirstIndex(solver._covFirstIndex),
+    _covNHarmonics(solver._covNHarmonics),
+    _covVCSErrVersion(solver._covVCSErrVersion) {}
 
 ISRSolverTSVD::~ISRSolverTSVD() {}
 
@@ -54,11 +82,17 @@ void ISRSolverTSVD::solve() {
   if (!_isEqMatrixPrepared) {
     evalEqMatrix();
     _isEqMatrixPrepared = true;
+    _isSVDPrepared = false;
+  }
+  if (!_isSVDPrepared) {
+    ISR_PROFILE_SCOPE("TSVD.svd");
     Eigen::JacobiSVD<Eigen::MatrixXd> svd(getIntegralOperatorMatrix(),
                                           Eigen::ComputeFullV | Eigen::ComputeFullU);
     _mU = svd.matrixU();
     _mV = svd.matrixV();
     _mSing = svd.singularValues();
+    _isSVDPrepared = true;
+    _isTSVDCovMatrixPrepared = false;
   }
   int firstIndex = 0;
   int n = _upperTSVDIndex;
@@ -66,11 +100,35 @@ void ISRSolverTSVD::solve() {
     firstIndex = _upperTSVDIndex - 1;
     n = 1;
   }
-  Eigen::MatrixXd mK = _mU.block(0, firstIndex, _mU.rows(), n) *
-                       _mSing.segment(firstIndex, n).asDiagonal() *
-                       _mV.block(0, firstIndex, _mV.rows(), n).transpose();
-  _bcs() = mK.completeOrthogonalDecomposition().solve(_vcs());
-  _getBornCSCovMatrix() = (mK.transpose() * _vcsInvCovMatrix() * mK).inverse();
+  const bool isCovMatrixPrepared =
+      _isTSVDCovMatrixPrepared && _covFirstIndex == firstIndex &&
+      _covNHarmonics == n && _covVCSErrVersion == _getVCSErrVersion();
+  ISR_PROFILE_SCOPE("TSVD.solve");
+  ISR_NO_MALLOC_SCOPE(isCovMatrixPrepared &&
+                      _bcs().size() == static_cast<Eigen::Index>(_getN()));
+  /**
+   * Minimum norm solution of the truncated system:
+   sum of v_i (u_i^T vcs) / s_i over the kept harmonics
+   */
+  _bcs().setZero(_getN());
+  for (int i = firstIndex; i < firstIndex + n; ++i) {
+    if (_mSing(i) > 0) {
+      _bcs() += (_mU.col(i).dot(_vcs()) / _mSing(i)) * _mV.col(i);
+    }
+  }
+  if (isCovMatrixPrepared) {
+    return;
+  }
+  Eigen::MatrixXd mK = Eigen::MatrixXd::Zero(_getN(), _getN());
+  for (int i = firstIndex; i < firstIndex + n; ++i) {
+    mK.noalias() += _mSing(i) * (_mU.col(i) * _mV.col(i).transpose());
+  }
+  const Eigen::MatrixXd mWK = _vcsWhiten(mK);
+  _getBornCSCovMatrix() = (mWK.transpose() * mWK).inverse();
+  _isTSVDCovMatrixPrepared = true;
+  _covFirstIndex = firstIndex;
+  _covNHarmonics = n;
+  _covVCSErrVersion = _getVCSErrVersion();
 }
 
 void ISRSolverTSVD::setUpperTSVDIndex(int upperTSVDIndex) {
@@ -88,3 +146,10 @@ void ISRSolverTSVD::enableKeepOne() {
 void ISRSolverTSVD::disableKeepOne() {
   _keepOne = false;
 }
+
+void ISRSolverTSVD::_updateOperators(std::size_t index, bool inserted,
+                                     const std::vector<int>& columns) {
+  ISRSolverSLE::_updateOperators(index, inserted, columns);
+  _upperTSVDIndex = std::min<int>(_upperTSVDIndex, _getN());
+  _isSVDPrepared = false;
+}
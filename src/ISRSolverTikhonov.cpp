@@ -6,6 +6,10 @@
 
 #include <algorithm>
 #include <cmath>
+
+#include "NoMallocCheck.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -26,14 +30,26 @@ ISRSolverTikhonov::ISRSolverTikhonov(std::size_t numberOfPoints,
                  energyErr, visibleCSErr,
                  thresholdEnergy, efficiency),
     _enabledDerivNorm2Reg(true),
-    _lambda(1.) {}
+    _lambda(1.),
+    _areWeightedMatricesPrepared(false),
+    _weightedMatricesVCSErrVersion(0),
+    _areProblemMatricesPrepared(false),
+    _problemMatricesLambda(0),
+    _isLuLPrepared(false),
+    _nLowRankUpdates(0) {}
 
 ISRSolverTikhonov::ISRSolverTikhonov(TGraphErrors* vcsGraph,
                                      double thresholdEnergy,
                                      double lambda) :
     ISRSolverSLE(vcsGraph, thresholdEnergy),
     _enabledDerivNorm2Reg(true),
-    _lambda(lambda) {}
+    _lambda(lambda),
+    _areWeightedMatricesPrepared(false),
+    _weightedMatricesVCSErrVersion(0),
+    _areProblemMatricesPrepared(false),
+    _problemMatricesLambda(0),
+    _isLuLPrepared(false),
+    _nLowRankUpdates(0) {}
 
 ISRSolverTikhonov::ISRSolverTikhonov(TGraphErrors* vcsGraph,
                                      TEfficiency* eff,
@@ -41,20 +57,43 @@ ISRSolverTikhonov::ISRSolverTikhonov(TGraphErrors* vcsGraph,
                                      double lambda) :
     ISRSolverSLE(vcsGraph, eff, thresholdEnergy),
     _enabledDerivNorm2Reg(true),
-    _lambda(lambda) {}
+    _lambda(lambda),
+    _areWeightedMatricesPrepared(false),
+    _weightedMatricesVCSErrVersion(0),
+    _areProblemMatricesPrepared(false),
+    _problemMatricesLambda(0),
+    _isLuLPrepared(false),
+    _nLowRankUpdates(0) {}
 
 ISRSolverTikhonov::ISRSolverTikhonov(const std::string& inputPath,
                                      const InputOptions& inputOpts,
                                      double lambda)
     : ISRSolverSLE(inputPath, inputOpts),
       _enabledDerivNorm2Reg(true),
-      _lambda(lambda) {}
+      _lambda(lambda),
+      _areWeightedMatricesPrepared(false),
+      _weightedMatricesVCSErrVersion(0),
+      _areProblemMatricesPrepared(false),
+      _problemMatricesLambda(0),
+      _isLuLPrepared(false),
+      _nLowRankUpdates(0) {}
 
 ISRSolverTikhonov::ISRSolverTikhonov(const ISRSolverTikhonov& solver) :
     ISRSolverSLE(solver),
-    _enabledDerivNorm2Reg(true),
+    _enabledDerivNorm2Reg(solver._enabledDerivNorm2Reg),
     _lambda(solver._lambda),
-    _interpPointWiseDerivativeProjector(solver._interpPointWiseDerivativeProjector) {}
+    _interpPointWiseDerivativeProjector(solver._interpPointWiseDerivativeProjector),
+    _mF(solver._mF),
+    _mWA(solver._mWA),
+    _mAtWA(solver._mAtWA),
+    _mFInvAtWA(solver._mFInvAtWA),
+    _areWeightedMatricesPrepared(solver._areWeightedMatricesPrepared),
+    _weightedMatricesVCSErrVersion(solver._weightedMatricesVCSErrVersion),
+    _areProblemMatricesPrepared(false),
+    _problemMatricesLambda(solver._problemMatricesLambda),
+    _isLuLPrepared(false),
+    _luF(solver._luF),
+    _nLowRankUpdates(solver._nLowRankUpdates) {}
 
 ISRSolverTikhonov::~ISRSolverTikhonov() {}
 
@@ -64,11 +103,38 @@ void ISRSolverTikhonov::solve() {
     evalEqMatrix();
     _evalInterpPointWiseDerivativeProjector();
     _isEqMatrixPrepared = true;
+    _areWeightedMatricesPrepared = false;
+  }
+  if (!_areWeightedMatricesPrepared ||
+      _weightedMatricesVCSErrVersion != _getVCSErrVersion()) {
+    if (!_updateProblemMatricesLowRank()) {
+      _evalWeightedMatrices();
+    }
   }
-  _evalProblemMatrices();
-  Eigen::MatrixXd mAp = _luT.solve(getIntegralOperatorMatrix().transpose() * _vcsInvCovMatrix());
-  _bcs() = mAp * _vcs();
-  _getBornCSCovMatrix() = mAp * _vcsInvCovMatrix().inverse() * mAp.transpose();
+  /**
+   * Workspaces are sized by the first call
+   */
+  ISR_NO_MALLOC_SCOPE(_mG.rows() == static_cast<Eigen::Index>(_getN()));
+  /**
+   * mG = T^-1 (L^-1 A)^T, so that the solution is mG L^-1 vcs and
+   the covariance matrix T^-1 A^T C^-1 A T^-1 is mG mG^T. Both are kept
+   until the errors or the regularization parameter are changed, so that
+   a new visible cross section costs one matrix-vector product.
+   */
+  if (!_areProblemMatricesPrepared || _problemMatricesLambda != _lambda ||
+      _weightedMatricesVCSErrVersion != _getVCSErrVersion()) {
+    _evalProblemMatrices();
+    {
+      ISR_PROFILE_SCOPE("Tikhonov.gain");
+      _mG.noalias() = _luT.solve(_mWA.transpose());
+    }
+    ISR_PROFILE_SCOPE("Tikhonov.covariance");
+    _getBornCSCovMatrix().noalias() = _mG * _mG.transpose();
+  }
+  ISR_PROFILE_SCOPE("Tikhonov.solve");
+  _whitenedVCS = _vcs();
+  _vcsWhitenInPlace(&_whitenedVCS);
+  _bcs().noalias() = _mG * _whitenedVCS;
 }
 
 double ISRSolverTikhonov::getLambda() const {
@@ -81,10 +147,12 @@ bool ISRSolverTikhonov::isDerivNorm2RegIsEnabled() const {
 
 void ISRSolverTikhonov::enableDerivNorm2Regularizator() {
   _enabledDerivNorm2Reg = true;
+  _areWeightedMatricesPrepared = false;
 }
 
 void ISRSolverTikhonov::disableDerivNorm2Regularizator() {
   _enabledDerivNorm2Reg = false;
+  _areWeightedMatricesPrepared = false;
 }
 
 void ISRSolverTikhonov::setLambda(double lambda) { _lambda = lambda; }
@@ -104,8 +172,8 @@ ISRSolverTikhonov::_getInterpPointWiseDerivativeProjector() const {
 }
 
 double ISRSolverTikhonov::evalEqNorm2() const {
-  Eigen::VectorXd dv = getIntegralOperatorMatrix() * bcs() - _vcs();
-  return dv.dot(_vcsInvCovMatrix() * dv);
+  const Eigen::VectorXd dv = getIntegralOperatorMatrix() * bcs() - _vcs();
+  return _vcsWhiten(dv).squaredNorm();
 }
 
 double ISRSolverTikhonov::evalSmoothnessConstraintNorm2() const {
@@ -113,14 +181,15 @@ double ISRSolverTikhonov::evalSmoothnessConstraintNorm2() const {
 }
 
 double ISRSolverTikhonov::evalLCurveCurvature() const {
-  Eigen::VectorXd ds = -_luL.solve(bcs());
+  Eigen::VectorXd ds = -_getLuL().solve(bcs());
   double dksi = _evaldKsidLambda(ds);
   return -std::fabs(1. / dksi / std::pow(1. + _lambda * _lambda, 1.5));
 }
 
 double ISRSolverTikhonov::evalLCurveCurvatureDerivative() const {
-  Eigen::VectorXd ds = -_luL.solve(bcs());
-  Eigen::VectorXd d2s = -2. * _luL.solve(ds);
+  const auto& luL = _getLuL();
+  Eigen::VectorXd ds = -luL.solve(bcs());
+  Eigen::VectorXd d2s = -2. * luL.solve(ds);
   double dksi = _evaldKsidLambda(ds);
   double d2ksi = _evald2Ksid2Lambda(ds, d2s);
   return -d2ksi * std::pow(dksi, -2.) * std::pow(1. + _lambda * _lambda, -1.5) +
@@ -136,8 +205,8 @@ double ISRSolverTikhonov::_evald2Ksid2Lambda(const Eigen::VectorXd& ds,
   return 2. * ds.dot(_mF * ds) + 2. * bcs().dot(_mF * d2s);
 }
 
-void ISRSolverTikhonov::_evalProblemMatrices() {
-  Eigen::MatrixXd mAt = getIntegralOperatorMatrix().transpose();
+void ISRSolverTikhonov::_evalWeightedMatrices() {
+  ISR_PROFILE_SCOPE("Tikhonov.weightedMatrices");
   _mF = Eigen::MatrixXd::Zero(_getN(), _getN());
   if (isDerivNorm2RegIsEnabled()) {
     _mF += _getInterpPointWiseDerivativeProjector().transpose() *
@@ -146,10 +215,107 @@ void ISRSolverTikhonov::_evalProblemMatrices() {
   } else {
     _mF += _getDotProdOp().asDiagonal();
   }
-  Eigen::MatrixXd mT = mAt * _vcsInvCovMatrix() * getIntegralOperatorMatrix() +
-        _lambda * _mF;
-  _mL = _mF.inverse() * mAt * _vcsInvCovMatrix() * getIntegralOperatorMatrix() +
-        _lambda * Eigen::MatrixXd::Identity(_getN(), _getN());
-  _luT = Eigen::FullPivLU<Eigen::MatrixXd>(mT);
-  _luL = Eigen::FullPivLU<Eigen::MatrixXd>(_mL);
+  _mWA = _vcsWhiten(getIntegralOperatorMatrix());
+  _mAtWA.noalias() = _mWA.transpose() * _mWA;
+  _luF.compute(_mF);
+  _mFInvAtWA = _luF.solve(_mAtWA);
+  _areWeightedMatricesPrepared = true;
+  _weightedMatricesVCSErrVersion = _getVCSErrVersion();
+  _areProblemMatricesPrepared = false;
+  _nLowRankUpdates = 0;
+}
+
+void ISRSolverTikhonov::_evalProblemMatrices() {
+  if (!_areWeightedMatricesPrepared ||
+      _weightedMatricesVCSErrVersion != _getVCSErrVersion()) {
+    _evalWeightedMatrices();
+  }
+  ISR_PROFILE_SCOPE("Tikhonov.problemMatrices");
+  _mT = _mAtWA + _lambda * _mF;
+  _luT.compute(_mT);
+  _isLuLPrepared = false;
+  _areProblemMatricesPrepared = true;
+  _problemMatricesLambda = _lambda;
+}
+
+const Eigen::FullPivLU<Eigen::MatrixXd>& ISRSolverTikhonov::_getLuL() const {
+  if (!_isLuLPrepared) {
+    ISR_PROFILE_SCOPE("Tikhonov.luL");
+    _mL = _mFInvAtWA;
+    _mL.diagonal().array() += _problemMatricesLambda;
+    _luL.compute(_mL);
+    _isLuLPrepared = true;
+  }
+  return _luL;
+}
+
+bool ISRSolverTikhonov::_updateProblemMatricesLowRank() {
+  const auto& changes = _getLastVCSErrChanges();
+  if (!_areWeightedMatricesPrepared || !_areProblemMatricesPrepared ||
+      _problemMatricesLambda != _lambda || !_isLastVCSErrUpdateDiagonal() ||
+      _weightedMatricesVCSErrVersion + 1 != _getVCSErrVersion() ||
+      8 * changes.size() > _getN() ||
+      _nLowRankUpdates + changes.size() > _getN()) {
+    return false;
+  }
+  ISR_PROFILE_SCOPE("Tikhonov.lowRankUpdate");
+  /**
+   * A change of the weight of the point i by delta gives
+   T' = T + delta a a^T, a is the row i of the integral operator matrix.
+   With u = T^-1 a (the column i of mG multiplied by the previous error),
+   s = a^T u and c = delta / (1 + delta s):
+   T'^-1 = T^-1 - c u u^T,
+   mG' = (mG - c u (mWA u)^T) with the column i scaled by the error ratio,
+   Cov' = Cov - c (u v^T + v u^T) + (c^2 a^T v + delta / (1 + delta s)^2) u u^T,
+   where v = Cov a
+   */
+  Eigen::MatrixXd& covMatrix = _getBornCSCovMatrix();
+  for (const auto& change : changes) {
+    const std::size_t i = change.first;
+    const double ratio = change.second / _vcsErr()(i);
+    const double delta = 1. / (_vcsErr()(i) * _vcsErr()(i)) -
+                         1. / (change.second * change.second);
+    const Eigen::VectorXd a = getIntegralOperatorMatrix().row(i).transpose();
+    const Eigen::VectorXd u = _mG.col(i) * change.second;
+    const double den = 1. + delta * a.dot(u);
+    if (!std::isfinite(delta) || !std::isfinite(ratio) || !(den > 1.e-8)) {
+      return false;
+    }
+    const double c = delta / den;
+    const Eigen::VectorXd v = covMatrix * a;
+    const double uu = c * c * a.dot(v) + delta / (den * den);
+    covMatrix.noalias() -= c * u * v.transpose();
+    covMatrix.noalias() -= c * v * u.transpose();
+    covMatrix.noalias() += uu * u * u.transpose();
+    const Eigen::VectorXd wau = _mWA * u;
+    _mG.noalias() -= c * u * wau.transpose();
+    _mG.col(i) *= ratio;
+    _mWA.row(i) *= ratio;
+    _mAtWA.noalias() += delta * a * a.transpose();
+    const Eigen::VectorXd fInvA = _luF.solve(a);
+    _mFInvAtWA.noalias() += delta * fInvA * a.transpose();
+  }
+  _isLuLPrepared = false;
+  _weightedMatricesVCSErrVersion = _getVCSErrVersion();
+  _nLowRankUpdates += changes.size();
+  return true;
+}
+
+void ISRSolverTikhonov::_updateOperators(std::size_t index, bool inserted,
+                                         const std::vector<int>& columns) {
+  ISRSolverSLE::_updateOperators(index, inserted, columns);
+  if (inserted) {
+    insertMatrixRowCol(&_interpPointWiseDerivativeProjector, index);
+    for (std::size_t j = 0; j < _getN(); ++j) {
+      _interpPointWiseDerivativeProjector(index, j) = _interp.basisDerivEval(j, _ecm(index));
+    }
+  } else {
+    eraseMatrixRowCol(&_interpPointWiseDerivativeProjector, index);
+  }
+  for (const int j : columns) {
+    for (std::size_t i = 0; i < _getN(); ++i) {
+      _interpPointWiseDerivativeProjector(i, j) = _interp.basisDerivEval(j, _ecm(i));
+    }
+  }
+  _areWeightedMatricesPrepared = false;
 }
@@ -1,6 +1,5 @@
 #include <algorithm>
-#include "Integration.hpp"
-#include "KuraevFadin.hpp"
+#include "Parallel.hpp"
 #include "ISRSolverVCSFitter.hpp"
 
 ISRSolverVCSFitFunction::ISRSolverVCSFitFunction(
@@ -11,10 +10,10 @@ ISRSolverVCSFitFunction::ISRSolverVCSFitFunction(
     const std::function<double(double, const std::vector<double>&)>& fit_fcn,
     const std::function<double(double, double)>& eff_fcn) :
     _energySpread(false),
-    _threshold(threshold),
+    _nThreads(1),
     _errorDef(1.),
     _fcn(fit_fcn),
-    _eff(eff_fcn) {
+    _radiator(threshold, eff_fcn) {
   _ecm.resize(n);
   _vcs.resize(n);
   if (energy_err) {
@@ -39,27 +38,25 @@ double ISRSolverVCSFitFunction::Up() const {
 
 double ISRSolverVCSFitFunction::operator()(
     const std::vector<double>& par) const {
-  double chi2 = 0;
   std::function<double(double)> bcs_fcn =
-      [par, this](double en) {
+      [&par, this](double en) {
         const double result = this->_fcn(en, par);
         return result;
       };
-  std::function<double(double)> vcs_no_spread =
-      [bcs_fcn, this](double en) {
-        const double sT = this->_threshold * this->_threshold;
-        const double s = en * en;
-        if (s <= sT) {
-          return 0.;
-        }
-        const double result = convolutionKuraevFadin(
-            en, bcs_fcn, 0, 1. - sT / s, this->_eff);
-        return result;
-      };
-  for (std::size_t i = 0; i < _ecm.size(); ++i) {
-    const double dvcs = gaussian_conv(
-        _ecm[i], _ecmErr[i] * _ecmErr[i], vcs_no_spread) - _vcs[i];
-    chi2 += dvcs * dvcs / _vcsErr[i] / _vcsErr[i];
+  // Per-point terms are summed in index order after the parallel loop,
+  // so chi-square does not depend on the number of threads
+  std::vector<double> terms(_ecm.size());
+  parallelFor(_ecm.size(), _nThreads,
+              [&terms, &bcs_fcn, this](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i) {
+                  const double dvcs = _radiator.apply(
+                      _ecm[i], _ecmErr[i] * _ecmErr[i], bcs_fcn) - _vcs[i];
+                  terms[i] = dvcs * dvcs / _vcsErr[i] / _vcsErr[i];
+                }
+              });
+  double chi2 = 0;
+  for (const double term : terms) {
+    chi2 += term;
   }
   return chi2;
 }
@@ -75,3 +72,118 @@ void ISRSolverVCSFitFunction::enableEnergySpread() {
 void ISRSolverVCSFitFunction::disableEnergySpread() {
   _energySpread = false;
 }
+
+void ISRSolverVCSFitFunction::setNumberOfThreads(std::size_t nThreads) {
+  _nThreads = nThreads;
+}
+
+std::size_t ISRSolverVCSFitFunction::getNumberOfThreads() const {
+  return _nThreads;
+}
+
+ISRSolverVCSFitFunctionGrad::ISRSolverVCSFitFunctionGrad(
+    std::size_t n,
+    double threshold,
+    double* energy, double* vis_cs,
+    double* energy_err, double* vis_cs_err,
+    const std::function<double(double, const std::vector<double>&)>& fit_fcn,
+    const std::function<void(double, const std::vector<double>&,
+                             std::vector<double>&)>& grad_fcn,
+    const std::function<double(double, double)>& eff_fcn) :
+    _fitFunction(n, threshold, energy, vis_cs,
+                 energy_err, vis_cs_err, fit_fcn, eff_fcn),
+    _gradFcn(grad_fcn),
+    _radiator(threshold, eff_fcn) {
+  _radiator.setPoints(n, _fitFunction._ecm.data(), _fitFunction._ecmErr.data());
+}
+
+ISRSolverVCSFitFunctionGrad::~ISRSolverVCSFitFunctionGrad() {}
+
+double ISRSolverVCSFitFunctionGrad::Up() const {
+  return _fitFunction.Up();
+}
+
+double ISRSolverVCSFitFunctionGrad::operator()(
+    const std::vector<double>& par) const {
+  const std::size_t n = _fitFunction._ecm.size();
+  // Per-point terms are summed in index order after the parallel loop
+  std::vector<double> terms(n);
+  parallelFor(n, _fitFunction._nThreads,
+              [&terms, &par, this](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i) {
+                  const double sigma = _fitFunction._vcsErr[i];
+                  const double dvcs = _evalVCS(i, par, nullptr) - _fitFunction._vcs[i];
+                  terms[i] = dvcs * dvcs / sigma / sigma;
+                }
+              });
+  double chi2 = 0;
+  for (const double term : terms) {
+    chi2 += term;
+  }
+  return chi2;
+}
+
+std::vector<double> ISRSolverVCSFitFunctionGrad::Gradient(
+    const std::vector<double>& par) const {
+  const std::size_t n = _fitFunction._ecm.size();
+  const std::size_t nPar = par.size();
+  // Per-point gradients are reduced in index order after the parallel loop
+  std::vector<double> terms(n * nPar, 0.);
+  parallelFor(n, _fitFunction._nThreads,
+              [&terms, &par, nPar, this](std::size_t first, std::size_t last) {
+                std::vector<double> dvcs(nPar);
+                for (std::size_t i = first; i < last; ++i) {
+                  const double vcs = _evalVCS(i, par, &dvcs);
+                  const double sigma = _fitFunction._vcsErr[i];
+                  const double factor = 2 * (vcs - _fitFunction._vcs[i]) / sigma / sigma;
+                  for (std::size_t p = 0; p < nPar; ++p) {
+                    terms[i * nPar + p] = factor * dvcs[p];
+                  }
+                }
+              });
+  std::vector<double> grad(nPar, 0.);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t p = 0; p < nPar; ++p) {
+      grad[p] += terms[i * nPar + p];
+    }
+  }
+  return grad;
+}
+
+double ISRSolverVCSFitFunctionGrad::_evalVCS(std::size_t i,
+                                             const std::vector<double>& par,
+                                             std::vector<double>* dvcs) const {
+  const auto& nodes = _radiator.getNodes();
+  const auto& offset = _radiator.getOffsets();
+  std::vector<double> dbcs;
+  if (dvcs) {
+    dbcs.resize(par.size());
+    std::fill(dvcs->begin(), dvcs->end(), 0.);
+  }
+  double vcs = 0;
+  for (std::size_t k = offset[i]; k < offset[i + 1]; ++k) {
+    const double en = nodes.energy[k];
+    const double w = nodes.weight[k];
+    vcs += w * _fitFunction._fcn(en, par);
+    if (dvcs) {
+      std::fill(dbcs.begin(), dbcs.end(), 0.);
+      _gradFcn(en, par, dbcs);
+      for (std::size_t p = 0; p < dbcs.size(); ++p) {
+        (*dvcs)[p] += w * dbcs[p];
+      }
+    }
+  }
+  return vcs;
+}
+
+void ISRSolverVCSFitFunctionGrad::setErrorDef(double def) {
+  _fitFunction.setErrorDef(def);
+}
+
+void ISRSolverVCSFitFunctionGrad::setNumberOfThreads(std::size_t nThreads) {
+  _fitFunction.setNumberOfThreads(nThreads);
+}
+
+std::size_t ISRSolverVCSFitFunctionGrad::getNumberOfThreads() const {
+  return _fitFunction.getNumberOfThreads();
+}
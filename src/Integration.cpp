@@ -1,16 +1,57 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_integration.h>
 #include "Integration.hpp"
+#include "Profiler.hpp"
+
+namespace {
+std::mutex gslHandlerMutex;
+std::size_t gslHandlerUsers = 0;
+gsl_error_handler_t* gslOldHandler = nullptr;
+thread_local IntegrationStats threadStats = {0, 0};
+thread_local double threadTolerance = 1.0e-12;
+
+/**
+ * Switches the global GSL error handler off while at least one
+ * integration is running, so that concurrent calls from several threads
+ * do not restore each other's handler too early
+ */
+class GSLErrorHandlerOff {
+ public:
+  GSLErrorHandlerOff() {
+    std::lock_guard<std::mutex> lock(gslHandlerMutex);
+    if (gslHandlerUsers++ == 0) {
+      gslOldHandler = gsl_set_error_handler_off();
+    }
+  }
+  ~GSLErrorHandlerOff() {
+    std::lock_guard<std::mutex> lock(gslHandlerMutex);
+    if (--gslHandlerUsers == 0) {
+      gsl_set_error_handler(gslOldHandler);
+    }
+  }
+};
+}  // namespace
+
+/**
+ * Integrand and a number of its evaluations
+ */
+typedef struct {
+  std::function<double(double)>* fcn;
+  std::size_t nEvals;
+} IntegrandParams;
 
 /**
  * Wrapper that converts std::function to appropriate format
  */
-double wrapper(double x, void* fcnp) {
-  auto fp = static_cast<std::function<double(double)>*>(fcnp);
-  return (*fp)(x);
+double wrapper(double x, void* params) {
+  auto p = static_cast<IntegrandParams*>(params);
+  p->nEvals++;
+  return (*(p->fcn))(x);
 }
 
 /**
@@ -18,31 +59,42 @@ double wrapper(double x, void* fcnp) {
  */
 double integrateS(std::function<double(double)>& fcn, double a, double b,
                   double& error) {
+  ISR_PROFILE_SCOPE("integrateS");
   int N = 100000;
-  gsl_error_handler_t* old_handler = gsl_set_error_handler_off();
+  GSLErrorHandlerOff handlerOff;
   gsl_integration_workspace* w = gsl_integration_workspace_alloc(N);
+  IntegrandParams params = {&fcn, 0};
   gsl_function F;
   F.function = &wrapper;
-  F.params = &fcn;
+  F.params = &params;
   double result;
-  double relerr = 1.0e-12;
+  double relerr = threadTolerance;
   int status = 1;
   while (status) {
     status = gsl_integration_qags(&F, a, b, 1.e-12, relerr, N, w, &result, &error);
+    if (status) {
+      // Each failed attempt is retried with an escalated tolerance
+      ISR_PROFILE_COUNT("integrateS.toleranceEscalations", 1);
+      ISR_PROFILE_COUNT(std::string("integrateS.gslFailures.") + gsl_strerror(status), 1);
+    }
 
     if (relerr < 1.e-3) {
       relerr *= 10;
     } else {
       relerr *= 1.1;
       if (status) {
+        ISR_PROFILE_COUNT("integrateS.toleranceWarnings", 1);
         std::cout << "AS: Warning: tolerance increased to " << relerr
                   << std::endl;
       }
     }
   }
 
+  threadStats.evaluations += params.nEvals;
+  threadStats.intervals += w->size;
   gsl_integration_workspace_free(w);
-  gsl_set_error_handler(old_handler);
+  ISR_PROFILE_COUNT("integrateS.evaluations", params.nEvals);
+  ISR_PROFILE_MAX("integrateS.maxEvaluationsPerCall", params.nEvals);
 
   return result;
 }
@@ -52,31 +104,86 @@ double integrateS(std::function<double(double)>& fcn, double a, double b,
  */
 double integrate(std::function<double(double)>& fcn, double a, double b,
                  double& error) {
+  ISR_PROFILE_SCOPE("integrate");
   int N = 1000000;
-  gsl_error_handler_t* old_handler = gsl_set_error_handler_off();
+  GSLErrorHandlerOff handlerOff;
   gsl_integration_workspace* w = gsl_integration_workspace_alloc(N);
+  IntegrandParams params = {&fcn, 0};
   gsl_function F;
   F.function = &wrapper;
-  F.params = &fcn;
+  F.params = &params;
   double result;
-  double relerr = 1.0e-12;
+  double relerr = threadTolerance;
   int status = 1;
   while (status) {
     status =
         gsl_integration_qag(&F, a, b, 1.e-12, relerr, N, 6, w, &result, &error);
+    if (status) {
+      // Each failed attempt is retried with an escalated tolerance
+      ISR_PROFILE_COUNT("integrate.toleranceEscalations", 1);
+      ISR_PROFILE_COUNT(std::string("integrate.gslFailures.") + gsl_strerror(status), 1);
+    }
 
     if (relerr < 1.e-3) {
       relerr *= 10;
     } else {
       relerr *= 1.1;
       if (status) {
+        ISR_PROFILE_COUNT("integrate.toleranceWarnings", 1);
         std::cout << "A: Warning: tolerance increased to " << relerr
                   << std::endl;
       }
     }
   }
+  threadStats.evaluations += params.nEvals;
+  threadStats.intervals += w->size;
+  gsl_integration_workspace_free(w);
+  ISR_PROFILE_COUNT("integrate.evaluations", params.nEvals);
+  ISR_PROFILE_MAX("integrate.maxEvaluationsPerCall", params.nEvals);
+  return result;
+}
+
+/**
+ * Adaptive integration with known breakpoints using GSL
+ */
+double integrateP(std::function<double(double)>& fcn, std::vector<double> points,
+                  double& error) {
+  ISR_PROFILE_SCOPE("integrateP");
+  int N = 1000000;
+  GSLErrorHandlerOff handlerOff;
+  gsl_integration_workspace* w = gsl_integration_workspace_alloc(N);
+  IntegrandParams params = {&fcn, 0};
+  gsl_function F;
+  F.function = &wrapper;
+  F.params = &params;
+  double result;
+  double relerr = threadTolerance;
+  int status = 1;
+  while (status) {
+    status = gsl_integration_qagp(&F, points.data(), points.size(), 1.e-12, relerr, N, w,
+                                  &result, &error);
+    if (status) {
+      // Each failed attempt is retried with an escalated tolerance
+      ISR_PROFILE_COUNT("integrateP.toleranceEscalations", 1);
+      ISR_PROFILE_COUNT(std::string("integrateP.gslFailures.") + gsl_strerror(status), 1);
+    }
+
+    if (relerr < 1.e-3) {
+      relerr *= 10;
+    } else {
+      relerr *= 1.1;
+      if (status) {
+        ISR_PROFILE_COUNT("integrateP.toleranceWarnings", 1);
+        std::cout << "AP: Warning: tolerance increased to " << relerr
+                  << std::endl;
+      }
+    }
+  }
+  threadStats.evaluations += params.nEvals;
+  threadStats.intervals += w->size;
   gsl_integration_workspace_free(w);
-  gsl_set_error_handler(old_handler);
+  ISR_PROFILE_COUNT("integrateP.evaluations", params.nEvals);
+  ISR_PROFILE_MAX("integrateP.maxEvaluationsPerCall", params.nEvals);
   return result;
 }
 
@@ -90,11 +197,35 @@ double gaussian_conv(double energy,
   gsl_integration_fixed_workspace * w;
   const gsl_integration_fixed_type * T = gsl_integration_fixed_hermite;
   w = gsl_integration_fixed_alloc(T, 6, energy, b, 0., 0.);
+  IntegrandParams params = {&fcn, 0};
   gsl_function F;
   F.function = &wrapper;
-  F.params = &fcn;
+  F.params = &params;
   double result;
   gsl_integration_fixed(&F, &result, w);
+  gsl_integration_fixed_free(w);
   result /= std::sqrt(2 * M_PI * sigma2);
+  threadStats.evaluations += params.nEvals;
   return result;
 }
+
+IntegrationStats integrationStats() {
+  return threadStats;
+}
+
+void resetIntegrationStats() {
+  threadStats = {0, 0};
+}
+
+IntegrationToleranceScope::IntegrationToleranceScope(double relerr) :
+    _previous(threadTolerance) {
+  threadTolerance = relerr;
+}
+
+IntegrationToleranceScope::~IntegrationToleranceScope() {
+  threadTolerance = _previous;
+}
+
+double integrationTolerance() {
+  return threadTolerance;
+}
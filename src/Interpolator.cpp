@@ -13,6 +13,7 @@ Interpolator::Interpolator() {}
  * Copy constructor
  */
 Interpolator::Interpolator(const Interpolator& interp):
+    _rangeInterpSettings(interp._rangeInterpSettings),
     _rangeInterpolators(interp._rangeInterpolators) {}
 
 /**
@@ -57,6 +58,7 @@ Interpolator::Interpolator(
     InterpRangeException ex;
     throw ex;
   }
+  _rangeInterpSettings = interpRSsorted;
   /**
    * Filling interpolators
    */
@@ -436,8 +438,10 @@ double Interpolator::getMaxEnergy(int csIndex) const {
  */
 double Interpolator::evalKuraevFadinBasisIntegral(
     int energyIndex, int csIndex,
-    const std::function<double(double, double)>& efficiency) const {
+    const std::function<double(double, double)>& efficiency,
+    double* error) const {
   double result = 0;
+  double totalError = 0;
   /**
    * Loop over all interpolation ranges
    */
@@ -446,9 +450,15 @@ double Interpolator::evalKuraevFadinBasisIntegral(
       /**
        * Evaluate contribution of each interpolation range
        */
-      result += rinterp.get()->evalKuraevFadinBasisIntegral(energyIndex, csIndex, efficiency);
+      double rangeError = 0;
+      result += rinterp.get()->evalKuraevFadinBasisIntegral(energyIndex, csIndex, efficiency,
+                                                            &rangeError);
+      totalError += rangeError;
     }
   }
+  if (error) {
+    *error = totalError;
+  }
   return result;
 }
 
@@ -509,3 +519,72 @@ double Interpolator::evalBasisSConvolution(
   }
   return result;
 }
+
+const std::vector<std::tuple<bool, int, int>>&
+Interpolator::getRangeInterpSettings() const {
+  return _rangeInterpSettings;
+}
+
+std::vector<int> Interpolator::getDependentCSIndices(int csIndex) const {
+  std::vector<int> result;
+  for (const auto& el : _rangeInterpSettings) {
+    bool interpType;
+    int rangeIndexMin;
+    int rangeIndexMax;
+    std::tie(interpType, rangeIndexMin, rangeIndexMax) = el;
+    /**
+     * Cross section points of the range (see BaseRangeInterpolator::hasCSIndex)
+     */
+    const int beginIndex = rangeIndexMin > 0 ? rangeIndexMin - 1 : 0;
+    const int first = interpType ? beginIndex : std::max(beginIndex, csIndex - 1);
+    const int last = interpType ? rangeIndexMax : std::min(rangeIndexMax, csIndex + 1);
+    for (int index = first; index <= last; ++index) {
+      result.push_back(index);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+std::vector<std::tuple<bool, int, int>> Interpolator::insertPointRangeInterpSettings(
+    const std::vector<std::tuple<bool, int, int>>& sortedInterpRangeSettings,
+    int csIndex, int n) {
+  auto result = sortedInterpRangeSettings;
+  for (auto& el : result) {
+    int& rangeIndexMin = std::get<1>(el);
+    int& rangeIndexMax = std::get<2>(el);
+    if (rangeIndexMin > csIndex) {
+      ++rangeIndexMin;
+    }
+    if (rangeIndexMax >= csIndex || rangeIndexMax == n - 1) {
+      ++rangeIndexMax;
+    }
+  }
+  return result;
+}
+
+std::vector<std::tuple<bool, int, int>> Interpolator::erasePointRangeInterpSettings(
+    const std::vector<std::tuple<bool, int, int>>& sortedInterpRangeSettings,
+    int csIndex, int n) {
+  std::vector<std::tuple<bool, int, int>> result;
+  result.reserve(sortedInterpRangeSettings.size());
+  /**
+   * Segments above the removed point are shifted down, the last
+   segment is dropped if the last point is removed
+   */
+  auto newSegmentIndex = [csIndex, n](int index) {
+    return std::min(index > csIndex ? index - 1 : index, n - 2);
+  };
+  int previousMax = -1;
+  for (const auto& el : sortedInterpRangeSettings) {
+    const int rangeIndexMin = std::max(newSegmentIndex(std::get<1>(el)), previousMax + 1);
+    const int rangeIndexMax = newSegmentIndex(std::get<2>(el));
+    if (rangeIndexMin > rangeIndexMax) {
+      continue;
+    }
+    result.push_back(std::make_tuple(std::get<0>(el), rangeIndexMin, rangeIndexMax));
+    previousMax = rangeIndexMax;
+  }
+  return result;
+}
@@ -5,6 +5,10 @@
 #include <TGraphErrors.h>
 #include <TMatrixD.h>
 #include "IterISRInterpSolver.hpp"
+#include "ColumnarIO.hpp"
+#include "NoMallocCheck.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
 using json = nlohmann::json;
 
 IterISRInterpSolver::IterISRInterpSolver(
@@ -17,27 +21,38 @@ IterISRInterpSolver::IterISRInterpSolver(
     ISRSolverSLE(numberOfPoints, energy, visibleCS,
                  energyErr, visibleCSErr,  thresholdEnergy,
                  efficiency),
-    _nIter(10) {}
+    _nIter(10),
+    _tolerance(0.),
+    _andersonDepth(0) {}
 
 IterISRInterpSolver::IterISRInterpSolver(TGraphErrors* vcsGraph,
                                          double thresholdEnergy) :
     ISRSolverSLE(vcsGraph, thresholdEnergy),
-    _nIter(10) {}
+    _nIter(10),
+    _tolerance(0.),
+    _andersonDepth(0) {}
 
 IterISRInterpSolver::IterISRInterpSolver(TGraphErrors* vcsGraph,
                                          TEfficiency* eff,
                                          double thresholdEnergy) :
     ISRSolverSLE(vcsGraph, eff, thresholdEnergy),
-    _nIter(10) {}
+    _nIter(10),
+    _tolerance(0.),
+    _andersonDepth(0) {}
 
 IterISRInterpSolver::IterISRInterpSolver(const std::string& inputPath,
                                          const InputOptions& inputOpts) :
     ISRSolverSLE(inputPath, inputOpts),
-    _nIter(10) {}
+    _nIter(10),
+    _tolerance(0.),
+    _andersonDepth(0) {}
 
 IterISRInterpSolver::IterISRInterpSolver(const IterISRInterpSolver& solver) :
     ISRSolverSLE(solver),
     _nIter(solver._nIter),
+    _tolerance(solver._tolerance),
+    _andersonDepth(solver._andersonDepth),
+    _residualHistory(solver._residualHistory),
     _radcorr(solver._radcorr) {}
 
 IterISRInterpSolver::~IterISRInterpSolver() {}
@@ -47,12 +62,86 @@ void IterISRInterpSolver::solve() {
     evalEqMatrix();
     _isEqMatrixPrepared = true;
   }
+  ISR_PROFILE_SCOPE("Iterative.solve");
+  _residualHistory.clear();
+  _residualHistory.reserve(_nIter);
+  /**
+   * Workspaces are sized by the first call, the Anderson
+   acceleration solves a small least squares problem each iteration
+   */
+  ISR_NO_MALLOC_SCOPE(_andersonDepth == 0 &&
+                      _curVCS.size() == static_cast<Eigen::Index>(_getN()));
+  if (_andersonDepth > 0) {
+    _andersonDF.resize(_getN(), _andersonDepth);
+    _andersonDG.resize(_getN(), _andersonDepth);
+  }
+  std::size_t nCols = 0;
   _bcs() = _vcs();
   for (std::size_t iter = 0; iter < _nIter; ++iter) {
-    Eigen::VectorXd curVCS = getIntegralOperatorMatrix() * _bcs();
-    _radcorr = curVCS.array() / _bcs().array();
-    _bcs() = _vcs().array() / _radcorr.array();
-    _getBornCSCovMatrix() = (_vcsErr().array() / _radcorr.array()).pow(2.).matrix().asDiagonal();
+    _curVCS.noalias() = getIntegralOperatorMatrix() * _bcs();
+    _radcorr = _curVCS.array() / _bcs().array();
+    _fixedPoint = _vcs().array() / _radcorr.array();
+    /**
+     * For plain iterations |g(x) - x| / |g(x)| is the relative change
+     of the radiative correction
+     */
+    const double residual =
+        ((_fixedPoint - _bcs()).array() / _fixedPoint.array()).abs().maxCoeff();
+    _residualHistory.push_back(residual);
+    if (_andersonDepth == 0 || residual < _tolerance) {
+      _bcs() = _fixedPoint;
+    } else {
+      if (iter > 0) {
+        if (nCols == _andersonDepth) {
+          _andersonDF.leftCols(nCols - 1) = _andersonDF.rightCols(nCols - 1).eval();
+          _andersonDG.leftCols(nCols - 1) = _andersonDG.rightCols(nCols - 1).eval();
+          --nCols;
+        }
+        _andersonDF.col(nCols) = (_fixedPoint - _bcs()) - _prevResidual;
+        _andersonDG.col(nCols) = _fixedPoint - _prevFixedPoint;
+        ++nCols;
+      }
+      _prevResidual = _fixedPoint - _bcs();
+      _prevFixedPoint = _fixedPoint;
+      _andersonStep(nCols);
+    }
+    if (residual < _tolerance) {
+      break;
+    }
+  }
+  if (_residualHistory.empty()) {
+    return;
+  }
+  if (_andersonDepth > 0) {
+    /**
+     * The radiative correction must correspond to the final solution
+     */
+    _radcorr = _vcs().array() / _bcs().array();
+  }
+  Eigen::MatrixXd& covMatrix = _getBornCSCovMatrix();
+  if (isVisibleCSCovMatrixFull()) {
+    covMatrix = (_getVCSCovMatrix().array().colwise() / _radcorr.array()).rowwise() /
+                _radcorr.transpose().array();
+  } else {
+    covMatrix.setZero(_getN(), _getN());
+    covMatrix.diagonal() = (_vcsErr().array() / _radcorr.array()).square().matrix();
+  }
+}
+
+void IterISRInterpSolver::_andersonStep(std::size_t nCols) {
+  if (nCols == 0) {
+    _bcs() = _fixedPoint;
+    return;
+  }
+  const Eigen::VectorXd gamma =
+      _andersonDF.leftCols(nCols).colPivHouseholderQr().solve(_prevResidual);
+  _bcs() = _fixedPoint - _andersonDG.leftCols(nCols) * gamma;
+  /**
+   * Fall back to the plain iteration if the extrapolated solution
+   can not be used to evaluate the radiative correction
+   */
+  if (!_bcs().allFinite() || (_bcs().array() == 0.).any()) {
+    _bcs() = _fixedPoint;
   }
 }
 
@@ -64,30 +153,73 @@ std::size_t IterISRInterpSolver::getNumOfIters() const {
   return _nIter;
 }
 
+void IterISRInterpSolver::setTolerance(double tolerance) {
+  _tolerance = tolerance;
+}
+
+double IterISRInterpSolver::getTolerance() const {
+  return _tolerance;
+}
+
+void IterISRInterpSolver::setAndersonDepth(std::size_t depth) {
+  _andersonDepth = depth;
+}
+
+std::size_t IterISRInterpSolver::getAndersonDepth() const {
+  return _andersonDepth;
+}
+
+std::size_t IterISRInterpSolver::getIterationCount() const {
+  return _residualHistory.size();
+}
+
+const std::vector<double>& IterISRInterpSolver::getResidualHistory() const {
+  return _residualHistory;
+}
+
 void IterISRInterpSolver::save(const std::string& outputPath,
                                const OutputOptions& outputOpts) {
-  TGraphErrors gvcs(_getN(), _ecm().data(), _vcs().data(), _ecmErr().data(),
-                   _vcsErr().data());
-  Eigen::VectorXd bcsErr = getBornCSCovMatrix().diagonal().array().pow(0.5);
-  TGraphErrors gbcs(_getN(), _ecm().data(), _bcs().data(), 0, bcsErr.data());
-  TGraph gradcor(_getN(), _ecm().data(), _radcorr.data());
-  TMatrixD intergalOperatorMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpIntOpM = getIntegralOperatorMatrix().transpose();
-  intergalOperatorMatrix.SetMatrixArray(tmpIntOpM.data());
-  TMatrixD bornCSCovMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpCovM = getBornCSCovMatrix().transpose();
-  bornCSCovMatrix.SetMatrixArray(tmpCovM.data());
-  TMatrixD bornCSInvCovMatrix(_getN(), _getN());
-  Eigen::MatrixXd tmpInvCovM = getBornCSCovMatrix().inverse().transpose();
-  bornCSInvCovMatrix.SetMatrixArray(tmpInvCovM.data());
+  ISR_PROFILE_SCOPE("Iterative.save");
+  if (isColumnarPath(outputPath)) {
+    const Eigen::VectorXd bcsErr = getBornCSCovMatrix().diagonal().array().pow(0.5);
+    ColumnarWriter writer;
+    _addColumnarEntries(&writer, outputOpts, bcsErr);
+    if (outputOpts.products & OutputRadiativeCorrection) {
+      writer.addGraph("radiative_correction", _getN(),
+                      _ecm().data(), nullptr, _radcorr.data(), nullptr);
+    }
+    writer.write(outputPath);
+    return;
+  }
+  const unsigned products = outputOpts.products;
   auto fl = TFile::Open(outputPath.c_str(), "recreate");
   fl->cd();
-  gvcs.Write(outputOpts.visibleCSGraphName.c_str());
-  gbcs.Write(outputOpts.bornCSGraphName.c_str());
-  gradcor.Write("radiative_correction");
-  intergalOperatorMatrix.Write("intergalOperatorMatrix");
-  bornCSCovMatrix.Write("covMatrixBornCS");
-  bornCSInvCovMatrix.Write("invCovMatrixBornCS");
+  if (products & OutputVisibleCS) {
+    TGraphErrors gvcs(_getN(), _ecm().data(), _vcs().data(), _ecmErr().data(),
+                      _vcsErr().data());
+    gvcs.Write(outputOpts.visibleCSGraphName.c_str());
+  }
+  if (products & OutputBornCS) {
+    Eigen::VectorXd bcsErr = getBornCSCovMatrix().diagonal().array().pow(0.5);
+    TGraphErrors gbcs(_getN(), _ecm().data(), _bcs().data(), 0, bcsErr.data());
+    gbcs.Write(outputOpts.bornCSGraphName.c_str());
+  }
+  if (products & OutputRadiativeCorrection) {
+    TGraph gradcor(_getN(), _ecm().data(), _radcorr.data());
+    gradcor.Write("radiative_correction");
+  }
+  if (products & OutputIntegralOperatorMatrix) {
+    writeTMatrixD(getIntegralOperatorMatrix(), "intergalOperatorMatrix");
+  }
+  if (products & OutputIntegralOperatorCost) {
+    _writeIntegralOperatorCost();
+  }
+  if (products & OutputBornCSCovMatrix) {
+    writeTMatrixD(getBornCSCovMatrix(), "covMatrixBornCS");
+  }
+  if (products & OutputBornCSInvCovMatrix) {
+    writeTMatrixD(getBornCSInvCovMatrix(), "invCovMatrixBornCS");
+  }
   fl->Close();
   delete fl;
 }
@@ -1,7 +1,8 @@
 #define _USE_MATH_DEFINES
-
+#include <algorithm>
 #include <cmath>
 #include <functional>
+#include <gsl/gsl_integration.h>
 
 #include "Integration.hpp"
 #include "PhysicalConstants.hpp"
@@ -53,21 +54,202 @@ double kernelMultiplicationKuraevFadin(
   return fcn(energy * std::sqrt(1 - x)) * kernelKuraevFadin(x, energy * energy);
 }
 
+std::vector<double> peakBreakpointsKuraevFadin(double energy, double min_x, double max_x,
+                                               const std::vector<double>& peaks) {
+  std::vector<double> result;
+  for (const double peak : peaks) {
+    if (peak <= 0 || peak >= energy) {
+      continue;
+    }
+    const double ratio = peak / energy;
+    const double x = 1 - ratio * ratio;
+    if (min_x < x && x < max_x) {
+      result.push_back(x);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
 double convolutionKuraevFadin(double energy,
-                                const std::function<double(double)>& fcn,
-                                double min_x, double max_x,
-				const std::function<double(double, double)>& efficiency) {
+                              const std::function<double(double)>& fcn,
+                              double min_x, double max_x,
+                              const std::function<double(double, double)>& efficiency,
+                              const std::vector<double>& peaks,
+                              double* error) {
   std::function<double(double)> fcnConv = [energy, &fcn, &efficiency](double x) {
     return kernelMultiplicationKuraevFadin(x, energy, fcn) * efficiency(x, energy);
   };
-  double error;
+  const std::vector<double> breaks =
+      peakBreakpointsKuraevFadin(energy, min_x, max_x, peaks);
+  // Integrates over [a, b] with the breakpoints that lie inside
+  double totalError = 0;
+  auto integrateRange = [&fcnConv, &breaks, &totalError](double a, double b, bool singular) {
+    double rangeError;
+    double rangeResult;
+    std::vector<double> points(1, a);
+    for (const double x : breaks) {
+      if (a < x && x < b) {
+        points.push_back(x);
+      }
+    }
+    if (points.size() > 1) {
+      points.push_back(b);
+      rangeResult = integrateP(fcnConv, points, rangeError);
+    } else if (singular) {
+      rangeResult = integrateS(fcnConv, a, b, rangeError);
+    } else {
+      rangeResult = integrate(fcnConv, a, b, rangeError);
+    }
+    totalError += rangeError;
+    return rangeResult;
+  };
   double x0 = 4 * ELECTRON_M / energy;
   double result;
   if (min_x < x0) {
-    result = integrateS(fcnConv, min_x, x0, error) +
-             integrate(fcnConv, x0, max_x, error);
+    result = integrateRange(min_x, x0, true) + integrateRange(x0, max_x, false);
   } else {
-    result = integrate(fcnConv, min_x, max_x, error);
+    result = integrateRange(min_x, max_x, false);
+  }
+  if (error) {
+    *error = totalError;
   }
   return result;
 }
+
+namespace {
+/**
+ * Appends Gauss-Legendre nodes of the interval [a, b] in the variable t,
+ * where x = x(t) and dx/dt are given by mapping
+ */
+void appendPanel(KuraevFadinRule* rule, double energy, double a, double b,
+                 const gsl_integration_glfixed_table* table, std::size_t order,
+                 const std::function<void(double, double&, double&)>& mapping,
+                 const std::function<double(double, double)>& efficiency) {
+  const double s = energy * energy;
+  for (std::size_t i = 0; i < order; ++i) {
+    double t;
+    double wt;
+    gsl_integration_glfixed_point(a, b, i, &t, &wt, table);
+    double x;
+    double dxdt;
+    mapping(t, x, dxdt);
+    if (x <= 0 || x >= 1) {
+      continue;
+    }
+    rule->x.push_back(x);
+    rule->ecm.push_back(energy);
+    rule->energy.push_back(energy * std::sqrt(1 - x));
+    rule->weight.push_back(wt * dxdt * kernelKuraevFadin(x, s) *
+                           efficiency(x, energy));
+  }
+}
+}  // namespace
+
+KuraevFadinRule ruleKuraevFadin(double energy,
+                                double min_x, double max_x,
+                                const std::function<double(double, double)>& efficiency,
+                                std::size_t nPanels,
+                                std::size_t order,
+                                const std::vector<double>& peaks) {
+  KuraevFadinRule rule;
+  if (max_x <= min_x) {
+    return rule;
+  }
+  gsl_integration_glfixed_table* table = gsl_integration_glfixed_table_alloc(order);
+  const double x0 = 4 * ELECTRON_M / energy;
+  const double x1 = 2 * ELECTRON_M / energy;
+  // Below x0 the kernel behaves like beta * x^(beta - 1), the substitution
+  // t = x^beta makes the integrand smooth. The panel boundary at x1 keeps
+  // the kernel threshold term off the interior nodes.
+  if (min_x < x0) {
+    const double beta = fBeta(energy * energy);
+    std::function<void(double, double&, double&)> powMapping =
+        [beta](double t, double& x, double& dxdt) {
+          x = std::pow(t, 1. / beta);
+          dxdt = x / (beta * t);
+        };
+    const double upper = std::min(x0, max_x);
+    const double ta = std::pow(min_x, beta);
+    const double tb = std::pow(upper, beta);
+    const double t1 = std::pow(x1, beta);
+    if (ta < t1 && t1 < tb) {
+      appendPanel(&rule, energy, ta, t1, table, order, powMapping, efficiency);
+      appendPanel(&rule, energy, t1, tb, table, order, powMapping, efficiency);
+    } else {
+      appendPanel(&rule, energy, ta, tb, table, order, powMapping, efficiency);
+    }
+  }
+  // Above x0 the kernel falls roughly as 1/x, panels are uniform in log(x)
+  const double lower = std::max(min_x, x0);
+  if (lower < max_x) {
+    std::function<void(double, double&, double&)> expMapping =
+        [](double t, double& x, double& dxdt) {
+          x = std::exp(t);
+          dxdt = x;
+        };
+    const double la = std::log(lower);
+    const double lb = std::log(max_x);
+    const double step = (lb - la) / nPanels;
+    // Peaks of the convoluted function become extra panel boundaries
+    std::vector<double> edges;
+    for (std::size_t k = 0; k <= nPanels; ++k) {
+      edges.push_back(la + k * step);
+    }
+    for (const double x : peakBreakpointsKuraevFadin(energy, lower, max_x, peaks)) {
+      edges.push_back(std::log(x));
+    }
+    std::sort(edges.begin(), edges.end());
+    for (std::size_t k = 0; k + 1 < edges.size(); ++k) {
+      if (edges[k + 1] > edges[k]) {
+        appendPanel(&rule, energy, edges[k], edges[k + 1],
+                    table, order, expMapping, efficiency);
+      }
+    }
+  }
+  gsl_integration_glfixed_table_free(table);
+  return rule;
+}
+
+void appendKuraevFadinRule(KuraevFadinRule* rule,
+                           const KuraevFadinRule& part,
+                           double factor) {
+  rule->x.insert(rule->x.end(), part.x.begin(), part.x.end());
+  rule->ecm.insert(rule->ecm.end(), part.ecm.begin(), part.ecm.end());
+  rule->energy.insert(rule->energy.end(), part.energy.begin(), part.energy.end());
+  for (const double w : part.weight) {
+    rule->weight.push_back(factor * w);
+  }
+}
+
+KuraevFadinRule ruleKuraevFadinSpread(double energy,
+                                      double sigma2,
+                                      double threshold,
+                                      const std::function<double(double, double)>& efficiency,
+                                      const std::vector<double>& peaks) {
+  const double sT = threshold * threshold;
+  KuraevFadinRule rule;
+  auto appendRule = [sT, &rule, &efficiency, &peaks](double en, double factor) {
+    const double s = en * en;
+    if (s <= sT) {
+      return;
+    }
+    appendKuraevFadinRule(&rule, ruleKuraevFadin(en, 0, 1. - sT / s, efficiency,
+                                                 32, 8, peaks), factor);
+  };
+  if (sigma2 <= 0) {
+    appendRule(energy, 1.);
+    return rule;
+  }
+  gsl_integration_fixed_workspace* w =
+      gsl_integration_fixed_alloc(gsl_integration_fixed_hermite, 6, energy, 0.5 / sigma2, 0., 0.);
+  const double* nodes = gsl_integration_fixed_nodes(w);
+  const double* weights = gsl_integration_fixed_weights(w);
+  const double norm = std::sqrt(2 * M_PI * sigma2);
+  for (std::size_t k = 0; k < gsl_integration_fixed_n(w); ++k) {
+    appendRule(nodes[k], weights[k] / norm);
+  }
+  gsl_integration_fixed_free(w);
+  return rule;
+}
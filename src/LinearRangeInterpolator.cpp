@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include "Integration.hpp"
 #include "KuraevFadin.hpp"
 #include "LinearRangeInterpolator.hpp"
@@ -56,20 +57,27 @@ double LinearRangeInterpolator::basisDerivEval(int csIndex, double energy) const
 
 double LinearRangeInterpolator::evalKuraevFadinBasisIntegral(
     int energyIndex, int csIndex,
-    const std::function<double(double, double)>& efficiency) const {
-  if (csIndex > energyIndex) {
-    return 0;
+    const std::function<double(double, double)>& efficiency,
+    double* error) const {
+  double firstError = 0;
+  double secondError = 0;
+  double result = 0;
+  if (csIndex <= energyIndex) {
+    result = _evalKuraevFadinBasisIntegralFirstTriangle(
+        energyIndex, csIndex, efficiency, &firstError);
+    result += _evalKuraevFadinBasisIntegralSecondTriangle(
+        energyIndex, csIndex, efficiency, &secondError);
+  }
+  if (error) {
+    *error = firstError + secondError;
   }
-  double result = _evalKuraevFadinBasisIntegralFirstTriangle(
-      energyIndex, csIndex, efficiency);
-  result += _evalKuraevFadinBasisIntegralSecondTriangle(
-      energyIndex, csIndex, efficiency);
   return result;
 }
 
 double LinearRangeInterpolator::_evalKuraevFadinBasisIntegralFirstTriangle(
     int energyIndex, int csIndex,
-    const std::function<double(double, double)>& efficiency) const {
+    const std::function<double(double, double)>& efficiency,
+    double* error) const {
   const double enc = _extCMEnergies(csIndex + 1);
   if (enc > _maxEnergy || enc <= _minEnergy) {
     return 0.;
@@ -77,14 +85,18 @@ double LinearRangeInterpolator::_evalKuraevFadinBasisIntegralFirstTriangle(
   const double en = _extCMEnergies(energyIndex + 1);
   const double x0 = std::max(0., 1 - std::pow(enc / en, 2));
   const double x1 = 1 - std::pow(_extCMEnergies(csIndex) / en, 2);
-  const double i00 = convolutionKuraevFadin(en, _fcn0, x0, x1, efficiency);
-  const double i01 = convolutionKuraevFadin(en, _fcn1, x0, x1, efficiency);
+  double error0;
+  double error1;
+  const double i00 = convolutionKuraevFadin(en, _fcn0, x0, x1, efficiency, {}, &error0);
+  const double i01 = convolutionKuraevFadin(en, _fcn1, x0, x1, efficiency, {}, &error1);
+  *error = std::abs(_c01(csIndex)) * error1 + std::abs(_c00(csIndex)) * error0;
   return _c01(csIndex) * i01 + _c00(csIndex) * i00;
 }
 
 double LinearRangeInterpolator::_evalKuraevFadinBasisIntegralSecondTriangle(
     int energyIndex, int csIndex,
-    const std::function<double(double, double)>& efficiency) const {
+    const std::function<double(double, double)>& efficiency,
+    double* error) const {
   if (csIndex + 2 >= _extCMEnergies.rows()) {
     return 0.;
   }
@@ -95,8 +107,11 @@ double LinearRangeInterpolator::_evalKuraevFadinBasisIntegralSecondTriangle(
   const double en = _extCMEnergies(energyIndex + 1);
   const double x0 = std::max(0., 1 - std::pow(encp / en, 2));
   const double x1 = 1 - std::pow(_extCMEnergies(csIndex + 1) / en, 2);
-  const double i10 = convolutionKuraevFadin(en, _fcn0, x0, x1, efficiency);
-  const double i11 = convolutionKuraevFadin(en, _fcn1, x0, x1, efficiency);
+  double error0;
+  double error1;
+  const double i10 = convolutionKuraevFadin(en, _fcn0, x0, x1, efficiency, {}, &error0);
+  const double i11 = convolutionKuraevFadin(en, _fcn1, x0, x1, efficiency, {}, &error1);
+  *error = std::abs(_c11(csIndex)) * error1 + std::abs(_c10(csIndex)) * error0;
   return _c11(csIndex) * i11 + _c10(csIndex) * i10;
 }
 
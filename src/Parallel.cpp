@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "Parallel.hpp"
+
+std::size_t hardwareConcurrency() {
+  const std::size_t nThreads = std::thread::hardware_concurrency();
+  return std::max<std::size_t>(nThreads, 1);
+}
+
+void parallelFor(std::size_t n, std::size_t nThreads,
+                 const std::function<void(std::size_t, std::size_t)>& fcn) {
+  if (n == 0) {
+    return;
+  }
+  if (nThreads == 0) {
+    nThreads = hardwareConcurrency();
+  }
+  nThreads = std::min(nThreads, n);
+  if (nThreads == 1) {
+    fcn(0, n);
+    return;
+  }
+  const std::size_t chunk = n / nThreads;
+  const std::size_t rest = n % nThreads;
+  std::vector<std::exception_ptr> errors(nThreads);
+  std::vector<std::thread> workers;
+  workers.reserve(nThreads - 1);
+  auto runChunk = [&fcn, &errors](std::size_t k,
+                                  std::size_t first, std::size_t last) {
+    try {
+      fcn(first, last);
+    } catch (...) {
+      errors[k] = std::current_exception();
+    }
+  };
+  std::size_t first = 0;
+  std::size_t firstChunkEnd = 0;
+  for (std::size_t k = 0; k < nThreads; ++k) {
+    const std::size_t last = first + chunk + (k < rest ? 1 : 0);
+    if (k == 0) {
+      firstChunkEnd = last;
+    } else {
+      workers.emplace_back(runChunk, k, first, last);
+    }
+    first = last;
+  }
+  // The calling thread processes the first chunk itself
+  runChunk(0, 0, firstChunkEnd);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <fstream>
+#include "Profiler.hpp"
+
+Profiler& Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+bool Profiler::isEnabled() {
+#ifdef ISRSOLVER_ENABLE_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Profiler::addTime(const std::string& phase, double seconds) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto& entry = _phases[phase];
+  entry.calls++;
+  entry.seconds += seconds;
+}
+
+void Profiler::addCount(const std::string& counter, std::size_t value) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _counters[counter] += value;
+}
+
+void Profiler::updateMax(const std::string& counter, std::size_t value) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto& entry = _counters[counter];
+  entry = std::max(entry, value);
+}
+
+void Profiler::reset() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _phases.clear();
+  _counters.clear();
+}
+
+nlohmann::json Profiler::report() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  nlohmann::json result;
+  result["enabled"] = isEnabled();
+  result["phases"] = nlohmann::json::object();
+  for (const auto& el : _phases) {
+    result["phases"][el.first] = {
+      {"calls", el.second.calls},
+      {"seconds", el.second.seconds}
+    };
+  }
+  result["counters"] = nlohmann::json::object();
+  for (const auto& el : _counters) {
+    result["counters"][el.first] = el.second;
+  }
+  return result;
+}
+
+void Profiler::dump(const std::string& path) const {
+  std::ofstream out(path);
+  out << report().dump(2) << std::endl;
+}
+
+ProfilerScopedTimer::ProfilerScopedTimer(const char* phase) :
+    _phase(phase), _start(std::chrono::steady_clock::now()) {}
+
+ProfilerScopedTimer::~ProfilerScopedTimer() {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - _start;
+  Profiler::instance().addTime(_phase, elapsed.count());
+}
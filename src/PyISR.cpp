@@ -5,6 +5,7 @@
 #include "PyISRSolverTikhonov.hpp"
 #include "PyIterISRSolverUseVCSFit.hpp"
 #include "PyFitVCS.hpp"
+#include "PyBatch.hpp"
 
 typedef struct {
     PyObject_HEAD
@@ -199,6 +200,8 @@ static PyMethodDef PyISR_funcs[] = {
    METH_VARARGS, kernelKuraevFadin_docs},
   {"convolutionKuraevFadin", (PyCFunction)pyConvolutionKuraevFadin,
    METH_VARARGS | METH_KEYWORDS, convolutionKuraevFadin_docs},
+  {"solve_batch", (PyCFunction)pySolveBatch,
+   METH_VARARGS | METH_KEYWORDS, solveBatch_docs},
   {NULL, NULL, 0, NULL}
 };
 
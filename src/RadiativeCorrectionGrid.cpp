@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cmath>
+#include "Profiler.hpp"
+#include "RadiativeCorrectionGrid.hpp"
+
+RadiativeCorrectionGrid::RadiativeCorrectionGrid(const RadiatorOperator& radiator) :
+    _threshold(radiator.getThreshold()),
+    _ecm(radiator.getEnergies()),
+    _radiator(radiator.getWeights()),
+    _interp(radiator.interpolation(radiator.getEnergies())) {
+  const auto& nodes = radiator.getNodes();
+  const std::size_t n = _ecm.size();
+  _nodeEnergy.resize(nodes.energy.size());
+  for (std::size_t k = 0; k < nodes.energy.size(); ++k) {
+    _nodeEnergy[k] = std::min(std::max(nodes.energy[k], _ecm(0)), _ecm(n - 1));
+  }
+  _nodeBorn.resize(nodes.energy.size());
+  _gridVCS.resize(n);
+}
+
+const Eigen::VectorXd& RadiativeCorrectionGrid::getEnergies() const {
+  return _ecm;
+}
+
+const std::vector<double>& RadiativeCorrectionGrid::getNodeEnergies() const {
+  return _nodeEnergy;
+}
+
+void RadiativeCorrectionGrid::setModel(const std::function<double(double)>& fcn) {
+  ISR_PROFILE_SCOPE("RadiativeCorrectionGrid::setModel");
+  _nodeModel.resize(_nodeEnergy.size());
+  for (std::size_t k = 0; k < _nodeEnergy.size(); ++k) {
+    _nodeModel(k) = fcn(_nodeEnergy[k]);
+  }
+  _gridModel.resize(_ecm.size());
+  for (Eigen::Index i = 0; i < _ecm.size(); ++i) {
+    _gridModel(i) = fcn(_ecm(i));
+  }
+}
+
+void RadiativeCorrectionGrid::setModelValues(const Eigen::VectorXd& nodeValues,
+                                             const Eigen::VectorXd& gridValues) {
+  if (nodeValues.size() != static_cast<Eigen::Index>(_nodeEnergy.size()) ||
+      gridValues.size() != _ecm.size()) {
+    throw RadiativeCorrectionGridException();
+  }
+  _nodeModel = nodeValues;
+  _gridModel = gridValues;
+}
+
+void RadiativeCorrectionGrid::iterate(const Eigen::VectorXd& radCorr,
+                                      Eigen::VectorXd* result) {
+  ISR_PROFILE_SCOPE("RadiativeCorrectionGrid::iterate");
+  _nodeBorn.noalias() = _interp * radCorr;
+  _nodeBorn = _nodeModel.array() / (1. + _nodeBorn.array());
+  _gridVCS.noalias() = _radiator * _nodeBorn;
+  result->resize(_ecm.size());
+  for (Eigen::Index i = 0; i < _ecm.size(); ++i) {
+    if (_ecm(i) <= _threshold) {
+      (*result)(i) = 0;
+      continue;
+    }
+    (*result)(i) = _gridVCS(i) * (1. + radCorr(i)) / _gridModel(i) - 1;
+    if (std::isnan((*result)(i))) {
+      (*result)(i) = 0;
+    }
+  }
+}
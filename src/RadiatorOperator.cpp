@@ -0,0 +1,148 @@
+#include <algorithm>
+#include "Integration.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+#include "RadiatorOperator.hpp"
+
+RadiatorOperator::RadiatorOperator(double threshold,
+                                   const std::function<double(double, double)>& efficiency) :
+    _threshold(threshold),
+    _efficiency(efficiency),
+    _offset(1, 0) {}
+
+double RadiatorOperator::getThreshold() const {
+  return _threshold;
+}
+
+const std::function<double(double, double)>& RadiatorOperator::getEfficiency() const {
+  return _efficiency;
+}
+
+void RadiatorOperator::setPeaks(const std::vector<double>& peaks) {
+  _peaks = peaks;
+}
+
+const std::vector<double>& RadiatorOperator::getPeaks() const {
+  return _peaks;
+}
+
+double RadiatorOperator::apply(double energy, double sigma2,
+                               const std::function<double(double)>& fcn) const {
+  const double sT = _threshold * _threshold;
+  std::function<double(double)> noSpread =
+      [sT, &fcn, this](double en) {
+        const double s = en * en;
+        if (s <= sT) {
+          return 0.;
+        }
+        return convolutionKuraevFadin(en, fcn, 0, 1. - sT / s, _efficiency, _peaks);
+      };
+  if (sigma2 <= 0) {
+    return noSpread(energy);
+  }
+  return gaussian_conv(energy, sigma2, noSpread);
+}
+
+void RadiatorOperator::setPoints(std::size_t n, const double* energy,
+                                 const double* energyErr, std::size_t nThreads) {
+  ISR_PROFILE_SCOPE("RadiatorOperator::setPoints");
+  std::vector<KuraevFadinRule> rules(n);
+  parallelFor(n, nThreads,
+              [&rules, energy, energyErr, this](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i) {
+                  const double sigma2 = energyErr ? energyErr[i] * energyErr[i] : 0.;
+                  rules[i] = ruleKuraevFadinSpread(energy[i], sigma2, _threshold,
+                                                   _efficiency, _peaks);
+                }
+              });
+  _energy = Eigen::Map<const Eigen::VectorXd>(energy, n);
+  _nodes = KuraevFadinRule();
+  _offset.assign(1, 0);
+  for (const auto& rule : rules) {
+    appendKuraevFadinRule(&_nodes, rule);
+    _offset.push_back(_nodes.energy.size());
+  }
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(_nodes.energy.size());
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t k = _offset[i]; k < _offset[i + 1]; ++k) {
+      triplets.emplace_back(i, k, _nodes.weight[k]);
+    }
+  }
+  _weights.resize(n, _nodes.energy.size());
+  _weights.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+const Eigen::VectorXd& RadiatorOperator::getEnergies() const {
+  return _energy;
+}
+
+const KuraevFadinRule& RadiatorOperator::getNodes() const {
+  return _nodes;
+}
+
+const std::vector<std::size_t>& RadiatorOperator::getOffsets() const {
+  return _offset;
+}
+
+void RadiatorOperator::scaleNodeWeights(const std::vector<double>& factors) {
+  for (std::size_t k = 0; k < factors.size() && k < _nodes.weight.size(); ++k) {
+    _nodes.weight[k] *= factors[k];
+  }
+  for (Eigen::Index i = 0; i < _weights.outerSize(); ++i) {
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(_weights, i); it; ++it) {
+      it.valueRef() = _nodes.weight[it.col()];
+    }
+  }
+}
+
+const Eigen::SparseMatrix<double, Eigen::RowMajor>& RadiatorOperator::getWeights() const {
+  return _weights;
+}
+
+void RadiatorOperator::apply(const std::function<double(double)>& fcn,
+                             Eigen::VectorXd* result) const {
+  Eigen::VectorXd nodeValues(_nodes.energy.size());
+  for (std::size_t k = 0; k < _nodes.energy.size(); ++k) {
+    nodeValues(k) = fcn(_nodes.energy[k]);
+  }
+  applyValues(nodeValues, result);
+}
+
+void RadiatorOperator::applyValues(const Eigen::VectorXd& nodeValues,
+                                   Eigen::VectorXd* result) const {
+  result->noalias() = _weights * nodeValues;
+}
+
+Eigen::SparseMatrix<double, Eigen::RowMajor>
+RadiatorOperator::interpolation(const Eigen::VectorXd& grid) const {
+  const std::size_t n = grid.size();
+  const std::size_t nNodes = _nodes.energy.size();
+  Eigen::SparseMatrix<double, Eigen::RowMajor> result(nNodes, n);
+  if (n == 0) {
+    return result;
+  }
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(2 * nNodes);
+  const double* first = grid.data();
+  const double* last = grid.data() + n;
+  for (std::size_t k = 0; k < nNodes; ++k) {
+    const double en = std::min(std::max(_nodes.energy[k], grid(0)), grid(n - 1));
+    if (n == 1) {
+      triplets.emplace_back(k, 0, 1.);
+      continue;
+    }
+    std::size_t j = std::upper_bound(first, last, en) - first;
+    j = std::min(std::max<std::size_t>(j, 1), n - 1) - 1;
+    const double t = (en - grid(j)) / (grid(j + 1) - grid(j));
+    triplets.emplace_back(k, j, 1. - t);
+    triplets.emplace_back(k, j + 1, t);
+  }
+  result.setFromTriplets(triplets.begin(), triplets.end());
+  return result;
+}
+
+Eigen::SparseMatrix<double, Eigen::RowMajor>
+RadiatorOperator::matrix(const Eigen::VectorXd& grid) const {
+  return (_weights * interpolation(grid)).pruned();
+}
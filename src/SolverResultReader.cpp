@@ -0,0 +1,71 @@
+#include <TFile.h>
+#include <TGraphErrors.h>
+#include <TMatrixD.h>
+#include "SolverResultReader.hpp"
+
+SolverResultReader::SolverResultReader(const std::string& path) :
+    _rootFile(nullptr) {
+  if (isColumnarPath(path)) {
+    _columnar.reset(new ColumnarFile(path));
+  } else {
+    _rootFile = TFile::Open(path.c_str(), "read");
+  }
+}
+
+SolverResultReader::~SolverResultReader() {
+  if (_rootFile) {
+    _rootFile->Close();
+    delete _rootFile;
+  }
+}
+
+bool SolverResultReader::isMemoryMapped() const {
+  return _columnar.get() != nullptr;
+}
+
+Eigen::Map<const Eigen::MatrixXd> SolverResultReader::graph(const std::string& name) const {
+  if (_columnar) {
+    return _columnar->matrix(name);
+  }
+  auto it = _loaded.find(name);
+  if (it == _loaded.end()) {
+    auto gr = dynamic_cast<TGraphErrors*>(_rootFile->Get(name.c_str()));
+    if (!gr) {
+      throw ColumnarEntryException();
+    }
+    const int n = gr->GetN();
+    Eigen::MatrixXd& result = _loaded[name];
+    result.resize(n, 4);
+    result.col(0) = Eigen::Map<const Eigen::VectorXd>(gr->GetX(), n);
+    result.col(1) = Eigen::Map<const Eigen::VectorXd>(gr->GetEX(), n);
+    result.col(2) = Eigen::Map<const Eigen::VectorXd>(gr->GetY(), n);
+    result.col(3) = Eigen::Map<const Eigen::VectorXd>(gr->GetEY(), n);
+    delete gr;
+    it = _loaded.find(name);
+  }
+  return Eigen::Map<const Eigen::MatrixXd>(it->second.data(),
+                                           it->second.rows(), it->second.cols());
+}
+
+Eigen::Map<const Eigen::MatrixXd> SolverResultReader::matrix(const std::string& name) const {
+  if (_columnar) {
+    return _columnar->matrix(name);
+  }
+  auto it = _loaded.find(name);
+  if (it == _loaded.end()) {
+    auto mx = dynamic_cast<TMatrixD*>(_rootFile->Get(name.c_str()));
+    if (!mx) {
+      throw ColumnarEntryException();
+    }
+    /**
+     * TMatrixD keeps elements in row-major order
+     */
+    _loaded[name] =
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+            mx->GetMatrixArray(), mx->GetNrows(), mx->GetNcols());
+    delete mx;
+    it = _loaded.find(name);
+  }
+  return Eigen::Map<const Eigen::MatrixXd>(it->second.data(),
+                                           it->second.rows(), it->second.cols());
+}
@@ -1,4 +1,7 @@
+#include <map>
+#include <sstream>
 #include <nlopt.hpp>
+#include <TMatrixD.h>
 #include <TRandom3.h>
 #include "ISRSolverTikhonov.hpp"
 #include "Utils.hpp"
@@ -36,3 +39,90 @@ double lambdaObjective(unsigned n, const double* plambda, double* grad, void* so
    */
   return sp->evalLCurveCurvature();
 }
+
+void writeTMatrixD(const Eigen::MatrixXd& matrix, const std::string& name) {
+  TMatrixD result(matrix.rows(), matrix.cols());
+  /**
+   * TMatrixD keeps elements in row-major order
+   */
+  Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+      result.GetMatrixArray(), matrix.rows(), matrix.cols()) = matrix;
+  result.Write(name.c_str());
+}
+
+unsigned parseOutputProducts(const std::string& products) {
+  const std::map<std::string, unsigned> flags = {
+    {"vcs", OutputVisibleCS},
+    {"bcs", OutputBornCS},
+    {"intop", OutputIntegralOperatorMatrix},
+    {"cov", OutputBornCSCovMatrix},
+    {"invcov", OutputBornCSInvCovMatrix},
+    {"interp", OutputInterpFunction},
+    {"radcorr", OutputRadiativeCorrection},
+    {"cost", OutputIntegralOperatorCost},
+    {"all", OutputAllProducts}};
+  unsigned result = 0;
+  std::stringstream stream(products);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    auto it = flags.find(item);
+    if (it == flags.end()) {
+      throw OutputProductException();
+    }
+    result |= it->second;
+  }
+  return result;
+}
+
+std::vector<double> parseEnergyList(const std::string& energies) {
+  std::vector<double> result;
+  std::stringstream stream(energies);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      result.push_back(std::stod(item));
+    }
+  }
+  return result;
+}
+
+void insertVectorElement(Eigen::VectorXd* vec, std::size_t index, double value) {
+  const Eigen::Index k = index;
+  const Eigen::Index m = vec->size() - k;
+  Eigen::VectorXd result(vec->size() + 1);
+  result.head(k) = vec->head(k);
+  result(k) = value;
+  result.tail(m) = vec->tail(m);
+  vec->swap(result);
+}
+
+void eraseVectorElement(Eigen::VectorXd* vec, std::size_t index) {
+  const Eigen::Index k = index;
+  const Eigen::Index m = vec->size() - k - 1;
+  Eigen::VectorXd result(vec->size() - 1);
+  result.head(k) = vec->head(k);
+  result.tail(m) = vec->tail(m);
+  vec->swap(result);
+}
+
+void insertMatrixRowCol(Eigen::MatrixXd* matrix, std::size_t index) {
+  const Eigen::Index k = index;
+  const Eigen::Index m = matrix->rows() - k;
+  Eigen::MatrixXd result = Eigen::MatrixXd::Zero(matrix->rows() + 1, matrix->cols() + 1);
+  result.topLeftCorner(k, k) = matrix->topLeftCorner(k, k);
+  result.topRightCorner(k, m) = matrix->topRightCorner(k, m);
+  result.bottomLeftCorner(m, k) = matrix->bottomLeftCorner(m, k);
+  result.bottomRightCorner(m, m) = matrix->bottomRightCorner(m, m);
+  matrix->swap(result);
+}
+
+void eraseMatrixRowCol(Eigen::MatrixXd* matrix, std::size_t index) {
+  const Eigen::Index k = index;
+  const Eigen::Index m = matrix->rows() - k - 1;
+  Eigen::MatrixXd result(matrix->rows() - 1, matrix->cols() - 1);
+  result.topLeftCorner(k, k) = matrix->topLeftCorner(k, k);
+  result.topRightCorner(k, m) = matrix->topRightCorner(k, m);
+  result.bottomLeftCorner(m, k) = matrix->bottomLeftCorner(m, k);
+  result.bottomRightCorner(m, m) = matrix->bottomRightCorner(m, m);
+  matrix->swap(result);
+}
@@ -1,13 +1,20 @@
 #include <algorithm>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <TF1.h>
 #include <TFile.h>
+#include <TGraph.h>
 #include <TEfficiency.h>
-#include "KuraevFadin.hpp"
+#include <TROOT.h>
+#include "Parallel.hpp"
+#include "RadiatorOperator.hpp"
 #include "Utils.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 //!!! TO DO: insert efficiency
@@ -19,6 +26,10 @@ typedef struct {
    * Number of points used to plot the function
    */
   int n;
+  /**
+   * Number of worker threads
+   */
+  std::size_t nThreads;
   /**
    * Threshold energy
    */
@@ -40,6 +51,14 @@ typedef struct {
    * Path to the output .root file
    */
   std::string ofname;
+  /**
+   * Comma-separated list of narrow peak energies
+   */
+  std::string peaks;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -48,7 +67,9 @@ typedef struct {
 void setOptions(po::options_description* desc, CmdOptions* opts) {
   desc->add_options()("help,h", "help message")
       ("num-of-points,n", po::value<int>(&(opts->n))->default_value(10000), "number of center-of-mass energy points")
-      ("thsd,t", po::value<double>(&(opts->thsd)), "threshold energy (GeV)")(
+      ("thsd,t", po::value<double>(&(opts->thsd)), "threshold energy (GeV)")
+      ("threads,j", po::value<std::size_t>(&(opts->nThreads))->default_value(1),
+       "number of worker threads (0 means all cores)")(
       "fcn,f", po::value<std::string>(&(opts->fcn)),
       "name of the function that to be convoluted with the kernel function F(x,s)")(
       "ifname,i",
@@ -58,7 +79,11 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
       po::value<std::string>(&(opts->ofname))->default_value("output.root"),
       "path to output file")
       ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
-       "name of a detection efficiency object (TEfficiency*)");
+       "name of a detection efficiency object (TEfficiency*)")
+      ("peaks", po::value<std::string>(&(opts->peaks))->default_value(""),
+       "comma-separated list of narrow peak energies (GeV) used as quadrature breakpoints")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -96,44 +121,75 @@ int main(int argc, char* argv[]) {
   if (vmap.count("efficiency-name")) {
     teff = dynamic_cast<TEfficiency*>(fl->Get(opts.efficiency_name.c_str())->Clone());
   }
+  if (opts.nThreads != 1) {
+    ROOT::EnableThreadSafety();
+  }
+  const double minen = std::max(opts.thsd, fcn->GetXmin());
+  const double maxen = fcn->GetXmax();
+  const std::size_t n = std::max(opts.n, 1);
+  std::vector<double> ens(n);
+  std::vector<double> values(n);
+  const double step = n > 1 ? (maxen - minen) / (n - 1) : 0.;
+  for (std::size_t i = 0; i < n; ++i) {
+    ens[i] = minen + step * i;
+  }
   /**
-   * Converting the function to a form of std::function
-   */
-  std::function<double(double)> born_fcn = [&opts, &fcn](double en) {
-    const double e0 = opts.thsd;
-    const double e1 = fcn->GetXmin();
-    if (e0 < e1 && en < e1) {
-      return fcn->Eval(e1) * (en - e0) / (e1 - e0);
-    }
-    return fcn->Eval(en);
-  };
-  /**
-   * Converting the detection efficiency to a form of std::function
+   * Tabulating the convolution in parallel. Each chunk uses its own
+   * copy of the function (TF1 evaluation is not thread-safe). The
+   * detection efficiency is shared: its lookups are read-only and safe
+   * after ROOT::EnableThreadSafety().
    */
-  std::function<double(double, double)> eff =
-      [teff](double x, double en) {
-        int bin = teff->FindFixBin(x, en);
-        double result = teff->GetEfficiency(bin);
-        return result;
-      };
+  const std::vector<double> peaks = parseEnergyList(opts.peaks);
+  std::mutex cloneMutex;
+  parallelFor(n, opts.nThreads,
+              [&](std::size_t first, std::size_t last) {
+                std::unique_ptr<TF1> localFcn;
+                {
+                  std::lock_guard<std::mutex> lock(cloneMutex);
+                  localFcn.reset(dynamic_cast<TF1*>(fcn->Clone()));
+                }
+                /**
+                 * Converting the function to a form of std::function
+                 */
+                std::function<double(double)> born_fcn = [&opts, &localFcn](double en) {
+                  const double e0 = opts.thsd;
+                  const double e1 = localFcn->GetXmin();
+                  if (e0 < e1 && en < e1) {
+                    return localFcn->Eval(e1) * (en - e0) / (e1 - e0);
+                  }
+                  return localFcn->Eval(en);
+                };
+                /**
+                 * Converting the detection efficiency to a form of std::function
+                 */
+                std::function<double(double, double)> eff =
+                    [teff](double x, double en) {
+                      if (!teff) {
+                        return 1.;
+                      }
+                      int bin = teff->FindFixBin(x, en);
+                      double result = teff->GetEfficiency(bin);
+                      return result;
+                    };
+                RadiatorOperator radiator(opts.thsd, eff);
+                radiator.setPeaks(peaks);
+                for (std::size_t i = first; i < last; ++i) {
+                  values[i] = radiator.apply(ens[i], 0., born_fcn);
+                }
+                std::lock_guard<std::mutex> lock(cloneMutex);
+                localFcn.reset();
+              });
   /**
-   * Creating convolution function
+   * Creating convolution function that interpolates the tabulated
+   * values, so writing and drawing it is cheap
    */
+  TGraph vcsGraph(n, ens.data(), values.data());
   std::function<double(double*, double*)> vcs_fcn =
-      [opts, born_fcn, teff, eff](double* x, double* par) {
-        const double en = x[0];
-        const double s = en * en;
-        const double s_threshold = opts.thsd * opts.thsd;
-        double result = 0;
-        if (teff) {
-          result = convolutionKuraevFadin(en, born_fcn, 0, 1 - s_threshold / s, eff);
-        } else {
-          result = convolutionKuraevFadin(en, born_fcn, 0, 1 - s_threshold / s);
-        }
+      [&vcsGraph](double* x, double*) {
+        double result = vcsGraph.Eval(x[0]);
         return result;
       };
-  auto f_vcs = new TF1("f_vcs", vcs_fcn, std::max(opts.thsd, fcn->GetXmin()),
-                       fcn->GetXmax(), 0);
+  auto f_vcs = new TF1("f_vcs", vcs_fcn, minen, maxen, 0);
   f_vcs->SetNpx(opts.n);
   fl->Close();
   delete fl;
@@ -143,9 +199,12 @@ int main(int argc, char* argv[]) {
   auto fl_out = TFile::Open(opts.ofname.c_str(), "recreate");
   fl_out->cd();
   f_vcs->Write();
+  vcsGraph.Write("f_vcs_graph");
   fl_out->Close();
   delete f_vcs;
   delete fl_out;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
-
@@ -6,6 +6,7 @@
 #include <TGraph.h>
 #include <TFile.h>
 #include "ISRSolverTikhonov.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -49,6 +50,10 @@ typedef struct {
    * Path to the file with interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -79,7 +84,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
         "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -172,5 +179,8 @@ int main(int argc, char* argv[]) {
   curvature.Write("curvature");
   fl->Close();
   delete fl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include "Chi2Test.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -58,6 +59,10 @@ typedef struct {
    * Path to the .json file with interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -93,7 +98,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -153,5 +160,8 @@ int main(int argc, char* argv[]) {
                   .initialChi2Ampl = opts.ampl,
                   .outputPath = opts.ofname});
   }
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
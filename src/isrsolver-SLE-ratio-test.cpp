@@ -1,6 +1,7 @@
 #include <string>
 #include <boost/program_options.hpp>
 #include "RatioTest.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -57,6 +58,10 @@ typedef struct {
    * interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -90,7 +95,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -142,5 +149,8 @@ int main(int argc, char* argv[]) {
                   .modelVCSName = opts.name_of_model_vcs,
                   .modelBCSName = opts.name_of_model_bcs,
                   .outputPath = opts.ofname});
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <string>
 #include "ISRSolverTSVD.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -21,6 +23,11 @@ typedef struct {
    * graph (TGraphErrors)
    */
   std::string vcs_name;
+  /**
+   * Name of the full visible cross section covariance matrix
+   * (TMatrixD)
+   */
+  std::string vcs_cov_name;
   /**
    * Name of the detection efficiency
    * (TEfficiency)
@@ -41,6 +48,19 @@ typedef struct {
    * Path to the .json file with interpolation settings
    */
   std::string interp;
+  /**
+   * Comma-separated list of products to save
+   */
+  std::string products;
+  /**
+   * Target integral operator error in units of the visible
+   * cross section errors (error-controlled assembly)
+   */
+  double assembly_precision;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -51,10 +71,17 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
       ("help,h", "help message")
       ("thsd,t", po::value<double>(&(opts->thsd)), "threshold energy (GeV)")
       ("enable-energy-spread,g", "enable energy spread")
+      ("record-cost", "save per-cell integration cost of the integral operator matrix")
+      ("assembly-precision", po::value<double>(&(opts->assembly_precision)),
+       "enable error-controlled assembly of the integral operator matrix with "
+       "the target error in units of visible cross section errors (e.g. 0.1)")
       ("upper-tsvd-index,k", po::value<int>(&(opts->k))->default_value(1), "upper TSVD index")
       ("keep-one,z", "keep only k-th SVD harmonic")
       ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
        "name of a visible cross section graph (TGraphErrors*)")
+      ("vcs-cov-name", po::value<std::string>(&(opts->vcs_cov_name)),
+       "name of a full visible cross section covariance matrix (TMatrixD*), "
+       "visible cross section errors are used if not set")
       ("ifname,i", po::value<std::string>(&(opts->ifname))->default_value("vcs.root"),
        "path to input file")
       ("ofname,o", po::value<std::string>(&(opts->ofname))->default_value("bcs.root"),
@@ -62,7 +89,12 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
       ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
        "name of a detection efficiency object (TEfficiency*)")
       ("interp,r", po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("products", po::value<std::string>(&(opts->products))->default_value("all"),
+       "comma-separated list of products to save: vcs, bcs, intop, cov, invcov, "
+       "interp, radcorr, cost or all")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -90,10 +122,17 @@ int main(int argc, char* argv[]) {
       opts.ifname,
       {.efficiencyName = opts.efficiency_name,
        .visibleCSGraphName = opts.vcs_name,
-       .thresholdEnergy = opts.thsd}, 1);
+       .thresholdEnergy = opts.thsd,
+       .vcsCovMatrixName = opts.vcs_cov_name}, 1);
   if (vmap.count("enable-energy-spread")) {
     solver.enableEnergySpread();
   }
+  if (vmap.count("record-cost")) {
+    solver.enableCostRecording();
+  }
+  if (vmap.count("assembly-precision")) {
+    solver.enableErrorControlledAssembly(opts.assembly_precision);
+  }
   if (vmap.count("interp")) {
     solver.setRangeInterpSettings(opts.interp);
   }
@@ -112,6 +151,13 @@ int main(int argc, char* argv[]) {
    */
   solver.save(opts.ofname,
               {.visibleCSGraphName = opts.vcs_name,
-               .bornCSGraphName = "bcs"});
+               .bornCSGraphName = "bcs",
+               .products = parseOutputProducts(opts.products)});
   solver.printConditionNumber();
+  if (vmap.count("assembly-precision")) {
+    solver.printIntegralOperatorErrorBound();
+  }
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
 }
@@ -4,6 +4,7 @@
 #include <nlopt.hpp>
 #include "ISRSolverTikhonov.hpp"
 #include "Utils.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -41,6 +42,10 @@ typedef struct {
    * Path to the .json file with interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -67,7 +72,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -131,5 +138,8 @@ int main(int argc, char* argv[]) {
   solver->save(opts.ofname,
                {.visibleCSGraphName = opts.vcs_name, .bornCSGraphName = "bcs"});
   delete solver;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -2,6 +2,7 @@
 #include <boost/program_options.hpp>
 #include "ISRSolverTikhonov.hpp"
 #include "RatioTest.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -62,6 +63,10 @@ typedef struct {
    * interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -98,7 +103,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "Path to output file.")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "Path to JSON file with interpolation settings.");
+       "Path to JSON file with interpolation settings.")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -158,5 +165,8 @@ int main(int argc, char* argv[]) {
                   .modelVCSName = opts.name_of_model_vcs,
                   .modelBCSName = opts.name_of_model_bcs,
                   .outputPath = opts.ofname});
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
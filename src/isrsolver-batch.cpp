@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <nlohmann/json.hpp>
+#include <TFile.h>
+#include <TGraphErrors.h>
+#include <TROOT.h>
+#include "ISRSolverTikhonov.hpp"
+#include "ISRSolverTSVD.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
+namespace po = boost::program_options;
+
+/**
+ * A part of program options
+ */
+typedef struct {
+  /**
+   * Threshold energy
+   */
+  double thsd;
+  /**
+   * Regularization parameter (Tikhonov method)
+   */
+  double lambda;
+  /**
+   * Upper TSVD index (TSVD method)
+   */
+  int k;
+  /**
+   * Number of worker threads
+   */
+  std::size_t nThreads;
+  /**
+   * Solver method: SLE, Tikhonov or TSVD
+   */
+  std::string method;
+  /**
+   * Default name of the visible cross section graph
+   * (TGraphErrors)
+   */
+  std::string vcs_name;
+  /**
+   * Default name of the detection efficiency object
+   * (TEfficiency)
+   */
+  std::string efficiency_name;
+  /**
+   * Path to the .json manifest with datasets
+   */
+  std::string manifest;
+  /**
+   * Path to the .json file with interpolation settings
+   */
+  std::string interp;
+  /**
+   * Comma-separated list of products to save
+   */
+  std::string products;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
+} CmdOptions;
+
+/**
+ * A dataset of the manifest
+ */
+typedef struct {
+  /**
+   * Path to the input .root file
+   */
+  std::string ifname;
+  /**
+   * Path to the output .root file
+   */
+  std::string ofname;
+  /**
+   * Name of the visible cross section graph
+   */
+  std::string vcsName;
+  /**
+   * Name of the detection efficiency object
+   */
+  std::string efficiencyName;
+  /**
+   * Center-of-mass energies in ascending order
+   */
+  std::vector<double> ecm;
+  /**
+   * Center-of-mass energy errors
+   */
+  std::vector<double> ecmErr;
+  /**
+   * Visible cross section
+   */
+  Eigen::VectorXd vcs;
+  /**
+   * Visible cross section errors
+   */
+  Eigen::VectorXd vcsErr;
+} BatchDataset;
+
+/**
+ * Datasets with equal keys share the integral operator matrix:
+ * efficiency source, center-of-mass energies and (with the energy spread)
+ * center-of-mass energy errors
+ */
+typedef std::tuple<std::string, std::vector<double>, std::vector<double>> OperatorKey;
+
+/**
+ * Setting up program options
+ */
+void setOptions(po::options_description* desc, CmdOptions* opts) {
+  desc->add_options()
+      ("help,h", "help message")
+      ("manifest,m", po::value<std::string>(&(opts->manifest))->default_value("batch.json"),
+       "path to JSON manifest: a list of {\"ifname\", \"ofname\", \"vcs_name\", "
+       "\"efficiency_name\"} objects")
+      ("method", po::value<std::string>(&(opts->method))->default_value("SLE"),
+       "solver method: SLE, Tikhonov or TSVD")
+      ("thsd,t", po::value<double>(&(opts->thsd)), "threshold energy (GeV)")
+      ("enable-energy-spread,g", "enable energy spread")
+      ("lambda,l", po::value<double>(&(opts->lambda))->default_value(1.),
+       "regularization parameter (Tikhonov method)")
+      ("use-solution-norm2,s",
+       "use the solution norm squared as the regularizator (Tikhonov method)")
+      ("upper-tsvd-index,k", po::value<int>(&(opts->k))->default_value(1),
+       "upper TSVD index (TSVD method)")
+      ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
+       "default name of a visible cross section graph (TGraphErrors*)")
+      ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
+       "default name of a detection efficiency object (TEfficiency*)")
+      ("interp,r", po::value<std::string>(&(opts->interp)),
+       "path to JSON file with interpolation settings")
+      ("threads,j", po::value<std::size_t>(&(opts->nThreads))->default_value(1),
+       "number of worker threads (0 means all cores)")
+      ("products", po::value<std::string>(&(opts->products))->default_value("all"),
+       "comma-separated list of products to save: vcs, bcs, intop, cov, invcov, "
+       "interp, radcorr, cost or all")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
+}
+
+/**
+ * Help message
+ */
+void help(const po::options_description& desc) {
+  std::cout << desc << std::endl;
+}
+
+/**
+ * Read a visible cross section graph of a dataset
+ * @return false if the graph is not found
+ */
+bool readDataset(BatchDataset* dataset) {
+  auto fl = TFile::Open(dataset->ifname.c_str(), "read");
+  if (!fl) {
+    return false;
+  }
+  auto graph = dynamic_cast<TGraphErrors*>(fl->Get(dataset->vcsName.c_str()));
+  if (!graph) {
+    fl->Close();
+    delete fl;
+    return false;
+  }
+  const std::size_t n = graph->GetN();
+  std::vector<std::size_t> index(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    index[i] = i;
+  }
+  /**
+   * Same order of points as in the solvers
+   */
+  std::sort(index.begin(), index.end(),
+            [graph](std::size_t i1, std::size_t i2)
+            { return graph->GetX()[i1] < graph->GetX()[i2]; });
+  dataset->ecm.resize(n);
+  dataset->ecmErr.resize(n);
+  dataset->vcs.resize(n);
+  dataset->vcsErr.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    dataset->ecm[i] = graph->GetX()[index[i]];
+    dataset->ecmErr[i] = graph->GetEX()[index[i]];
+    dataset->vcs(i) = graph->GetY()[index[i]];
+    dataset->vcsErr(i) = graph->GetEY()[index[i]];
+  }
+  fl->Close();
+  delete fl;
+  return true;
+}
+
+/**
+ * Create and configure a solver that builds the integral operator
+ * matrix of a group of datasets
+ */
+std::unique_ptr<ISRSolverSLE> createSolver(const BatchDataset& dataset,
+                                           const CmdOptions& opts,
+                                           const po::variables_map& vmap) {
+  const InputOptions inputOpts = {
+    .efficiencyName = dataset.efficiencyName,
+    .visibleCSGraphName = dataset.vcsName,
+    .thresholdEnergy = opts.thsd};
+  std::unique_ptr<ISRSolverSLE> solver;
+  if (opts.method == "Tikhonov") {
+    auto tikhonov = new ISRSolverTikhonov(dataset.ifname, inputOpts, opts.lambda);
+    if (vmap.count("use-solution-norm2")) {
+      tikhonov->disableDerivNorm2Regularizator();
+    }
+    solver.reset(tikhonov);
+  } else if (opts.method == "TSVD") {
+    solver.reset(new ISRSolverTSVD(dataset.ifname, inputOpts, opts.k));
+  } else {
+    solver.reset(new ISRSolverSLE(dataset.ifname, inputOpts));
+  }
+  if (vmap.count("enable-energy-spread")) {
+    solver->enableEnergySpread();
+  }
+  if (vmap.count("interp")) {
+    solver->setRangeInterpSettings(opts.interp);
+  }
+  return solver;
+}
+
+/**
+ * Copy a solver with a prepared integral operator matrix
+ */
+std::unique_ptr<ISRSolverSLE> copySolver(const std::string& method,
+                                         const ISRSolverSLE& solver) {
+  if (method == "Tikhonov") {
+    return std::unique_ptr<ISRSolverSLE>(
+        new ISRSolverTikhonov(dynamic_cast<const ISRSolverTikhonov&>(solver)));
+  }
+  if (method == "TSVD") {
+    return std::unique_ptr<ISRSolverSLE>(
+        new ISRSolverTSVD(dynamic_cast<const ISRSolverTSVD&>(solver)));
+  }
+  return std::unique_ptr<ISRSolverSLE>(new ISRSolverSLE(solver));
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc(
+      "   Solves a batch of visible cross sections. Datasets that share "
+      "center-of-mass energies and detection efficiency share "
+      "the integral operator matrix. Allowed options");
+  CmdOptions opts;
+  setOptions(&desc, &opts);
+  po::variables_map vmap;
+  po::store(po::parse_command_line(argc, argv, desc), vmap);
+  po::notify(vmap);
+  if (vmap.count("help")) {
+    help(desc);
+    return 0;
+  }
+  if (opts.method != "SLE" && opts.method != "Tikhonov" && opts.method != "TSVD") {
+    std::cerr << "[!] Unknown method: " << opts.method << std::endl;
+    return 1;
+  }
+  const bool energySpread = vmap.count("enable-energy-spread");
+  /**
+   * Reading the manifest and visible cross sections
+   */
+  std::ifstream fmanifest(opts.manifest);
+  nlohmann::json manifest;
+  fmanifest >> manifest;
+  std::vector<BatchDataset> datasets;
+  for (const auto& item : manifest) {
+    BatchDataset dataset;
+    dataset.ifname = item.at("ifname").get<std::string>();
+    dataset.ofname = item.at("ofname").get<std::string>();
+    dataset.vcsName = item.value("vcs_name", opts.vcs_name);
+    dataset.efficiencyName = item.value("efficiency_name", opts.efficiency_name);
+    if (!readDataset(&dataset)) {
+      std::cerr << "[!] Unable to read " << dataset.vcsName
+                << " from " << dataset.ifname << std::endl;
+      return 1;
+    }
+    datasets.push_back(std::move(dataset));
+  }
+  /**
+   * Grouping datasets by the integral operator matrix
+   */
+  std::map<OperatorKey, std::vector<std::size_t>> groupMap;
+  for (std::size_t i = 0; i < datasets.size(); ++i) {
+    const auto& dataset = datasets[i];
+    const std::string efficiencySource = dataset.efficiencyName.empty() ?
+        std::string() : dataset.ifname + ":" + dataset.efficiencyName;
+    groupMap[OperatorKey(efficiencySource, dataset.ecm,
+                         energySpread ? dataset.ecmErr : std::vector<double>())].push_back(i);
+  }
+  std::vector<std::vector<std::size_t>> groups;
+  for (auto& entry : groupMap) {
+    groups.push_back(std::move(entry.second));
+  }
+  std::cout << datasets.size() << " datasets, "
+            << groups.size() << " integral operator matrices" << std::endl;
+  if (opts.nThreads != 1) {
+    ROOT::EnableThreadSafety();
+  }
+  /**
+   * Building the integral operator matrix once per group
+   */
+  std::vector<std::unique_ptr<ISRSolverSLE>> prototypes;
+  std::vector<std::size_t> groupOf(datasets.size());
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    prototypes.push_back(createSolver(datasets[groups[g].front()], opts, vmap));
+    for (std::size_t i : groups[g]) {
+      groupOf[i] = g;
+    }
+  }
+  parallelFor(prototypes.size(), opts.nThreads,
+              [&prototypes](std::size_t first, std::size_t last) {
+                for (std::size_t g = first; g < last; ++g) {
+                  prototypes[g]->solve();
+                }
+              });
+  /**
+   * Solving datasets and streaming results to the output files
+   */
+  std::vector<std::size_t> order;
+  for (const auto& group : groups) {
+    order.insert(order.end(), group.begin(), group.end());
+  }
+  const unsigned products = parseOutputProducts(opts.products);
+  std::mutex outputMutex;
+  std::size_t nSaved = 0;
+  parallelFor(order.size(), opts.nThreads,
+              [&](std::size_t first, std::size_t last) {
+                for (std::size_t k = first; k < last; ++k) {
+                  const auto& dataset = datasets[order[k]];
+                  auto solver = copySolver(opts.method, *prototypes[groupOf[order[k]]]);
+                  solver->resetVisibleCS(dataset.vcs);
+                  solver->resetVisibleCSErrors(dataset.vcsErr);
+                  solver->solve();
+                  std::lock_guard<std::mutex> lock(outputMutex);
+                  solver->save(dataset.ofname,
+                               {.visibleCSGraphName = dataset.vcsName,
+                                .bornCSGraphName = "bcs",
+                                .products = products});
+                  std::cout << "[" << ++nSaved << "/" << order.size() << "] "
+                            << dataset.ifname << ":" << dataset.vcsName
+                            << " -> " << dataset.ofname << std::endl;
+                }
+              });
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
+  return 0;
+}
@@ -1,11 +1,13 @@
 #include <iostream>
+#include <string>
 #include <utility>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <Eigen/Dense>
 #include <TFile.h>
 #include <TF1.h>
-#include <TMatrixD.h>
-#include <TGraphErrors.h>
+#include "Profiler.hpp"
+#include "SolverResultReader.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -26,10 +28,19 @@ typedef struct {
    */
   std::string path_to_model;
   /**
-   * Path to a .root file with a numerical
+   * Path to a .root or .isrbin file with a numerical
    * solution (Born cross section) data
    */
   std::string ifname;
+  /**
+   * Paths to several files with numerical solutions
+   * evaluated against the same model
+   */
+  std::vector<std::string> batch;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -48,7 +59,11 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "name of the model Born cross section function (TF1*)")
       ( "ifname,i",
         po::value<std::string>(&(opts->ifname))->default_value("bcs.root"),
-        "path to input file");
+        "path to input file (.root or .isrbin)")
+      ("batch", po::value<std::vector<std::string>>(&(opts->batch))->multitoken(),
+       "paths to several input files evaluated against the same model")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -60,64 +75,38 @@ void help(const po::options_description& desc) {
 
 /**
  * Evaluate chi-square
- * @param opts a part of the program options
+ * @param reader a numerical solution (Born cross section) file reader
+ * @param bcsName a name of the numerical solution graph
+ * @param mbcs a model Born cross section
  */
-std::pair<double, double> evalChi2(const CmdOptions& opts) {
-  /**
-   * Opening input file that contains Born cross section (numerical solution),
-   * its covariance matrix and inverse covariance matrix
-   */
-  auto ifl = TFile::Open(opts.ifname.c_str(), "read");
-  ifl->cd();
-  /**
-   * Reading Born cross section (numerical solution)
-   */
-  auto ibcs = dynamic_cast<TGraphErrors*>(ifl->Get(opts.bcs_name.c_str())->Clone("ibcs"));
-  /**
-   * Reading inverse covariance matrix of the numerical solution
-   */
-  auto icovInv = dynamic_cast<TMatrixD*>(ifl->Get("invCovMatrixBornCS")->Clone("icovInv"));
-  /**
-   * Reading covariance matrix of the numerical solution
-   */
-  auto icov = dynamic_cast<TMatrixD*>(ifl->Get("covMatrixBornCS")->Clone("icov"));
-  ifl->Close();
-
-  int n = ibcs->GetN();
-  Eigen::Map<Eigen::VectorXd> x(ibcs->GetX(), n);
-  Eigen::Map<Eigen::VectorXd> data(ibcs->GetY(), n);
-  Eigen::Map<Eigen::MatrixXd> invCov(icovInv->GetMatrixArray(), n, n);
-  Eigen::Map<Eigen::MatrixXd> covMx(icov->GetMatrixArray(), n, n);
-  Eigen::VectorXd mdata =Eigen::VectorXd::Zero(n);
-
-  /**
-   * Opening the file with a model data
-   */
-  auto mfl = TFile::Open(opts.path_to_model.c_str(), "read");
-  mfl->cd();
+std::pair<double, double> evalChi2(const SolverResultReader& reader,
+                                   const std::string& bcsName,
+                                   TF1* mbcs) {
   /**
-   * Reading model Born cross section
+   * Born cross section (numerical solution), its covariance matrix and
+   * inverse covariance matrix (memory-mapped for .isrbin files)
    */
-  auto mbcs = dynamic_cast<TF1*>(mfl->Get(opts.name_of_model_bcs.c_str()));
+  const auto ibcs = reader.graph(bcsName);
+  const auto invCov = reader.matrix("invCovMatrixBornCS");
+  const auto covMx = reader.matrix("covMatrixBornCS");
+  const int n = ibcs.rows();
+  Eigen::VectorXd mdata(n);
   /**
    * Converting model Born cross section to a vector format
    */
-  for (int i = 0; i < x.size(); ++i) {
-    mdata(i) = mbcs->Eval(x(i));
+  for (int i = 0; i < n; ++i) {
+    mdata(i) = mbcs->Eval(ibcs(i, 0));
   }
-  mfl->Close();
-  delete mfl;
-  Eigen::VectorXd dy = data - mdata;
+  const Eigen::VectorXd dy = ibcs.col(2) - mdata;
   /**
    * Calculating chi-square using full covariance matrix
    */
   double chi2 = dy.dot(invCov * dy);
-  Eigen::VectorXd diagErr2 = covMx.diagonal().array().pow(-1.);
   /**
    * Calculating chi-square using only diagonal elements of
    * covariance matrix
    */
-  double chi2Diag = dy.dot(diagErr2.asDiagonal() * dy);
+  double chi2Diag = (dy.array().square() / covMx.diagonal().array()).sum();
   return std::make_pair(chi2, chi2Diag);
 }
 
@@ -132,8 +121,34 @@ int main(int argc, char* argv[]) {
     help(desc);
     return 0;
   }
-  auto chi2s = evalChi2(opts);
-  std::cout << "chi-square = " << chi2s.first << std::endl;
-  std::cout << "diagonal chi-square = " << chi2s.second << std::endl;
+  /**
+   * Opening the file with a model data
+   */
+  auto mfl = TFile::Open(opts.path_to_model.c_str(), "read");
+  mfl->cd();
+  /**
+   * Reading model Born cross section
+   */
+  auto mbcs = dynamic_cast<TF1*>(mfl->Get(opts.name_of_model_bcs.c_str()));
+  if (vmap.count("batch")) {
+    /**
+     * One line per result file: path, chi-square, diagonal chi-square
+     */
+    for (const auto& path : opts.batch) {
+      SolverResultReader reader(path);
+      auto chi2s = evalChi2(reader, opts.bcs_name, mbcs);
+      std::cout << path << " " << chi2s.first << " " << chi2s.second << std::endl;
+    }
+  } else {
+    SolverResultReader reader(opts.ifname);
+    auto chi2s = evalChi2(reader, opts.bcs_name, mbcs);
+    std::cout << "chi-square = " << chi2s.first << std::endl;
+    std::cout << "diagonal chi-square = " << chi2s.second << std::endl;
+  }
+  mfl->Close();
+  delete mfl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -7,6 +7,7 @@
 #include <TFile.h>
 #include "ISRSolverSLE.hpp"
 #include "Utils.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -47,6 +48,10 @@ typedef struct {
    * Path to the file that contains interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -71,7 +76,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        po::value<std::string>(&(opts->ofname))->default_value("cond_num_test.root"),
        "path to output file")
       ("interp,r", po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -143,5 +150,8 @@ int main(int argc, char* argv[]) {
   g_cond.Write("condnums");
   fl->Close();
   delete fl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -5,6 +5,7 @@
 #include <TF1.h>
 #include <TFile.h>
 #include "KuraevFadin.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -31,6 +32,10 @@ typedef struct {
    * Output file path
    */
   std::string ofname;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -45,7 +50,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
       ("xmax,x", po::value<double>(&(opts->xmax))->default_value(0.5), "maximum value of x")
       ("ofname,o", po::value<std::string>(&(opts->ofname))->
        default_value("output_kuraev-fadin_kernel_integral.root"),
-       "output file path");
+       "output file path")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -79,5 +86,8 @@ int main(int argc, char* argv[]) {
   ker_int_f.Write();
   fl->Close();
   delete fl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <Eigen/Dense>
+#include "ISRSolverTikhonov.hpp"
+#include "Profiler.hpp"
+namespace po = boost::program_options;
+
+/**
+ * A part of program options
+ */
+typedef struct {
+  /**
+   * Threshold energy
+   */
+  double thsd;
+  /**
+   * Maximum relative difference between incremental and full assembly
+   */
+  double tolerance;
+  /**
+   * Name of the visible cross section graph (TGraphErrors)
+   */
+  std::string vcs_name;
+  /**
+   * Name of the detection efficiency object (TEfficiency)
+   */
+  std::string efficiency_name;
+  /**
+   * Path to the input .root file that contains visible cross
+   * section and detection efficiency
+   */
+  std::string ifname;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
+} CmdOptions;
+
+/**
+ * Setting up program options
+ */
+void setOptions(po::options_description* desc, CmdOptions* opts) {
+  desc->add_options()
+      ("help,h", "help message")
+      ("thsd,t", po::value<double>(&(opts->thsd)), "threshold (GeV)")
+      ("tolerance,l", po::value<double>(&(opts->tolerance))->default_value(1.e-9),
+       "maximum relative difference between incremental and full assembly")
+      ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
+       "name of the visible cross section graph (TGraphErrors*)")
+      ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
+       "name of the detection efficiency object (TEfficiency*)")
+      ("ifname,i",
+       po::value<std::string>(&(opts->ifname))->default_value("vcs.root"),
+       "path to input file")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
+}
+
+/**
+ * Help message
+ */
+void help(const po::options_description& desc) {
+  std::cout << desc << std::endl;
+}
+
+/**
+ * Gives access to the operators that are updated by addPoint
+ * and removePoint
+ */
+class CheckedSolver : public ISRSolverTikhonov {
+ public:
+  using ISRSolverTikhonov::ISRSolverTikhonov;
+  const std::vector<std::tuple<bool, int, int>>& getRangeInterpSettings() const {
+    return _interp.getRangeInterpSettings();
+  }
+  const Eigen::RowVectorXd& getDotProdOp() const {
+    return _getDotProdOp();
+  }
+  const Eigen::MatrixXd& getDerivativeProjector() const {
+    return _getInterpPointWiseDerivativeProjector();
+  }
+  /**
+   * Assemble all operators from scratch on the current points
+   */
+  void assemble() {
+    setRangeInterpSettings(getRangeInterpSettings());
+    evalEqMatrix();
+    _evalDotProductOperator();
+    _evalInterpPointWiseDerivativeProjector();
+  }
+};
+
+/**
+ * Relative difference of two matrices (infinity if the sizes differ)
+ */
+double relativeDifference(const Eigen::MatrixXd& x, const Eigen::MatrixXd& y) {
+  if (x.rows() != y.rows() || x.cols() != y.cols()) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const double scale = std::max(y.cwiseAbs().maxCoeff(), 1.e-300);
+  return (x - y).cwiseAbs().maxCoeff() / scale;
+}
+
+/**
+ * Compare the operators of the solver updated incrementally with the
+ * operators of its copy assembled from scratch on the same points
+ * @param solver a solver updated by addPoint or removePoint
+ * @param label a label of the check
+ * @param tolerance a maximum relative difference
+ * @return true if the check is passed
+ */
+bool check(CheckedSolver* solver, const std::string& label, double tolerance) {
+  CheckedSolver full(*solver);
+  full.assemble();
+  solver->solve();
+  full.solve();
+  const double dIntOp = relativeDifference(solver->getIntegralOperatorMatrix(),
+                                           full.getIntegralOperatorMatrix());
+  const double dDotProd = relativeDifference(solver->getDotProdOp(), full.getDotProdOp());
+  const double dDeriv = relativeDifference(solver->getDerivativeProjector(),
+                                           full.getDerivativeProjector());
+  const double dBCS = relativeDifference(solver->bcs(), full.bcs());
+  const bool ok = dIntOp <= tolerance && dDotProd <= tolerance &&
+                  dDeriv <= tolerance && dBCS <= tolerance;
+  std::cout << (ok ? "[ OK ] " : "[FAIL] ") << label
+            << ": intop " << dIntOp << ", dotprod " << dDotProd
+            << ", deriv " << dDeriv << ", bcs " << dBCS << std::endl;
+  return ok;
+}
+
+/**
+ * Remove points and add them back, add a point between the existing
+ * points and remove it, comparing the operators after each step
+ * @param solver a solver with the interpolation settings applied
+ * @param label a label of the interpolation settings
+ * @param tolerance a maximum relative difference
+ * @return a number of failed checks
+ */
+int checkSettings(CheckedSolver* solver, const std::string& label, double tolerance) {
+  int nFailed = 0;
+  solver->solve();
+  const auto settings = solver->getRangeInterpSettings();
+  const std::size_t n = solver->getN();
+  for (const std::size_t index : {std::size_t(0), n / 2, n - 1}) {
+    const double energy = solver->ecm()(index);
+    const double energyErr = solver->ecmErr()(index);
+    const double vcs = solver->vcs()(index);
+    const double vcsErr = solver->vcsErr()(index);
+    const std::string point = std::to_string(index);
+    solver->removePoint(index);
+    nFailed += !check(solver, label + ", remove " + point, tolerance);
+    solver->addPoint(energy, energyErr, vcs, vcsErr);
+    nFailed += !check(solver, label + ", add " + point + " back", tolerance);
+    if (solver->getRangeInterpSettings() != settings) {
+      std::cout << "[FAIL] " << label << ", add " << point
+                << " back: interpolation settings are not restored" << std::endl;
+      ++nFailed;
+    }
+  }
+  const std::size_t index = n / 2;
+  const double energy = 0.5 * (solver->ecm()(index) + solver->ecm()(index + 1));
+  const std::size_t newIndex = solver->addPoint(
+      energy, 0.5 * (solver->ecmErr()(index) + solver->ecmErr()(index + 1)),
+      0.5 * (solver->vcs()(index) + solver->vcs()(index + 1)),
+      0.5 * (solver->vcsErr()(index) + solver->vcsErr()(index + 1)));
+  nFailed += !check(solver, label + ", add new", tolerance);
+  solver->removePoint(newIndex);
+  nFailed += !check(solver, label + ", remove new", tolerance);
+  if (solver->getRangeInterpSettings() != settings) {
+    std::cout << "[FAIL] " << label
+              << ", remove new: interpolation settings are not restored" << std::endl;
+    ++nFailed;
+  }
+  return nFailed;
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc(
+      "This tool checks that the operators updated by point insertion and "
+      "removal (ISRSolverSLE::addPoint, ISRSolverSLE::removePoint) match "
+      "the operators assembled from scratch on the same points. Piecewise "
+      "linear, cubic spline and mixed interpolation is checked with and "
+      "without the energy spread. Allowed options");
+  CmdOptions opts;
+  setOptions(&desc, &opts);
+  po::variables_map vmap;
+  po::store(po::parse_command_line(argc, argv, desc), vmap);
+  po::notify(vmap);
+  if (vmap.count("help")) {
+    help(desc);
+    return 0;
+  }
+  CheckedSolver solver(opts.ifname, {
+      .efficiencyName = opts.efficiency_name,
+      .visibleCSGraphName = opts.vcs_name,
+      .thresholdEnergy = opts.thsd});
+  const int n = solver.getN();
+  if (n < 4) {
+    std::cerr << "[!] At least 4 points are required." << std::endl;
+    return 1;
+  }
+  const std::vector<std::pair<std::string, std::vector<std::tuple<bool, int, int>>>> configs = {
+    {"linear", Interpolator::defaultInterpRangeSettings(n)},
+    {"spline", {std::make_tuple(true, 0, n - 1)}},
+    {"mixed", {std::make_tuple(false, 0, n / 2 - 1), std::make_tuple(true, n / 2, n - 1)}}};
+  int nFailed = 0;
+  for (const auto& config : configs) {
+    for (const bool spread : {false, true}) {
+      CheckedSolver local(solver);
+      local.enableIncrementalUpdates();
+      local.setRangeInterpSettings(config.second);
+      if (spread) {
+        local.enableEnergySpread();
+      } else {
+        local.disableEnergySpread();
+      }
+      nFailed += checkSettings(&local, config.first + (spread ? ", spread" : ""),
+                               opts.tolerance);
+    }
+  }
+  std::cout << (nFailed ? "[FAIL] " : "[ OK ] ") << nFailed
+            << " check(s) failed" << std::endl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
+  return nFailed ? 1 : 0;
+}
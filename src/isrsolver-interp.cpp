@@ -6,6 +6,7 @@
 #include <TF1.h>
 #include <TGraphErrors.h>
 #include "Interpolator.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -33,6 +34,10 @@ typedef struct {
    * settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -53,7 +58,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -125,5 +132,8 @@ int main(int argc, char* argv[]) {
   double emax = *std::max_element(x.begin(), x.end());
   interpBasis(v, *interp, emax, opts);
   delete interp;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -2,6 +2,7 @@
 #include <boost/program_options.hpp>
 #include "Chi2Test.hpp"
 #include "IterISRInterpSolver.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -63,6 +64,10 @@ typedef struct {
    * Path to the .json file with interpolation settings
    */
   std::string interp;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -100,7 +105,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "path to output file")
       ("interp,r",
        po::value<std::string>(&(opts->interp)),
-       "path to JSON file with interpolation settings");
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -160,5 +167,8 @@ int main(int argc, char* argv[]) {
                   .initialChi2Ampl = opts.ampl,
                   .outputPath = opts.ofname});
   }
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -14,8 +14,11 @@
 #include <TF1.h>
 #include <TFile.h>
 #include <TMatrixD.h>
-#include "Integration.hpp"
-#include "KuraevFadin.hpp"
+#include <TROOT.h>
+#include "EnergyGrid.hpp"
+#include "Profiler.hpp"
+#include "RadiativeCorrectionGrid.hpp"
+#include "Utils.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -30,6 +33,15 @@ typedef struct {
    * Number of points at which the radiative correction is calculated
    */
   std::size_t n;
+  /**
+   * Relative interpolation tolerance of the adaptive grid
+   * (0 means a uniform grid)
+   */
+  double grid_tolerance;
+  /**
+   * Maximum number of adaptive grid points
+   */
+  std::size_t max_grid_points;
   /**
    * Threshold energy
    */
@@ -38,6 +50,10 @@ typedef struct {
    * Center-of-mass energy spread
    */
   double energy_spread;
+  /**
+   * Number of worker threads
+   */
+  std::size_t nThreads;
   /**
    * Name of the visible cross section graph (TGraphErrors)
    */
@@ -59,6 +75,14 @@ typedef struct {
    * Path to the output file
    */
   std::string ofname;
+  /**
+   * Comma-separated list of narrow peak energies
+   */
+  std::string peaks;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -71,10 +95,17 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
       ("niter,n", po::value<std::size_t>(&(opts->niter))->default_value(10),
        "number of iterations")
       ("number-of-points,p", po::value<std::size_t>(&(opts->n))->default_value(100),
-       "number of iterations")
+       "number of points at which the radiative correction is calculated "
+       "(initial number of points of the adaptive grid)")
+      ("grid-tolerance", po::value<double>(&(opts->grid_tolerance))->default_value(0.),
+       "relative interpolation tolerance of the adaptive grid (0 means uniform grid)")
+      ("max-grid-points", po::value<std::size_t>(&(opts->max_grid_points))->default_value(10000),
+       "maximum number of adaptive grid points")
       ("thsd,t", po::value<double>(&(opts->thsd)), "threshold (GeV)")
       ("energy-spread,s", po::value<double>(&(opts->energy_spread))->default_value(0.),
        "Center-of-mass energy spread (GeV)")
+      ("threads,j", po::value<std::size_t>(&(opts->nThreads))->default_value(1),
+       "number of worker threads (0 means all cores)")
       ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
        "name of the visible cross section graph (TGraphErrors*)")
       ("fcn-vcs-name,f", po::value<std::string>(&(opts->fcn_vcs_name))->default_value("fcn_vcs"),
@@ -86,7 +117,11 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
         "Path to input file.")
       ("ofname,o",
        po::value<std::string>(&(opts->ofname))->default_value("bcs.root"),
-       "Path to output file.");
+       "Path to output file.")
+      ("peaks", po::value<std::string>(&(opts->peaks))->default_value(""),
+       "comma-separated list of narrow peak energies (GeV) used as quadrature breakpoints")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -129,94 +164,95 @@ int main(int argc, char* argv[]) {
   }
   fl->Close();
   delete fl;
-  Eigen::VectorXd ecm = Eigen::VectorXd::Zero(opts.n);
   const double minen = fcn->GetXmin();
   const double maxen = fcn->GetXmax();
-  const double eh = (maxen - opts.thsd) / (opts.n - 1);
-  for (std::size_t i = 0; i < opts.n; ++i) {
-    ecm(i) = opts.thsd + eh * i;
-  }
-  Eigen::VectorXd radCorr = Eigen::VectorXd::Zero(opts.n);
-  gsl_interp_accel *acc = gsl_interp_accel_alloc ();
-  gsl_spline *spline = gsl_spline_alloc(gsl_interp_linear, opts.n);
-  gsl_spline_init (spline, ecm.data(), radCorr.data(), opts.n);
-  std::function<double(double)> radFCN =
-      [&spline, &acc](double en) {
-        double result = gsl_spline_eval(spline, en, acc);
-        return result;
-      };
   /**
-   * Converting the function to a form of std::function
+   * Visible cross section fit function (the numerator of the Born
+   * cross section) with a linear ramp below the fit range
    */
-  std::function<double(double)> born_fcn =
-      [opts, maxen, &fcn, &radFCN](double en) {
+  std::function<double(double)> fit_fcn =
+      [opts, maxen, &fcn](double en) {
     const double e0 = opts.thsd;
     const double e1 = fcn->GetXmin();
     if (en <= e0) {
       return 0.;
     }
-    double result = 0;
     if (en >= maxen) {
-      result = fcn->Eval(maxen) / (1. + radFCN(maxen));
-      return result;
+      return fcn->Eval(maxen);
     }
     if (e0 < e1 && en < e1) {
-      result = fcn->Eval(e1) * (en - e0) / (e1 - e0) / (1. + radFCN(en));
-      return result;
+      return fcn->Eval(e1) * (en - e0) / (e1 - e0);
     }
-    result = fcn->Eval(en) / (1. + radFCN(en));
-    return result;
+    return fcn->Eval(en);
   };
+  /**
+   * Uniform grid or a grid refined where the fit function
+   * has high curvature
+   */
+  std::vector<double> grid(opts.n);
+  if (opts.grid_tolerance > 0) {
+    grid = adaptiveEnergyGrid(
+        opts.thsd, maxen, opts.n, opts.grid_tolerance, opts.max_grid_points,
+        [&fit_fcn](const std::vector<double>& energy, std::vector<double>* values) {
+          values->resize(energy.size());
+          for (std::size_t i = 0; i < energy.size(); ++i) {
+            (*values)[i] = fit_fcn(energy[i]);
+          }
+        });
+    std::cout << "Adaptive grid: " << grid.size() << " points" << std::endl;
+  } else {
+    const double eh = (maxen - opts.thsd) / (opts.n - 1);
+    for (std::size_t i = 0; i < opts.n; ++i) {
+      grid[i] = opts.thsd + eh * i;
+    }
+  }
+  const std::size_t n = grid.size();
+  Eigen::VectorXd ecm = Eigen::Map<const Eigen::VectorXd>(grid.data(), n);
+  Eigen::VectorXd radCorr = Eigen::VectorXd::Zero(n);
+  gsl_interp_accel *acc = gsl_interp_accel_alloc ();
+  gsl_spline *spline = gsl_spline_alloc(gsl_interp_linear, n);
+  gsl_spline_init (spline, ecm.data(), radCorr.data(), n);
+  std::function<double(double)> radFCN =
+      [&spline, &acc](double en) {
+        double result = gsl_spline_eval(spline, en, acc);
+        return result;
+      };
   /**
    * Converting the detection efficiency to a form of std::function
    */
   std::function<double(double, double)> eff =
       [teff](double x, double en) {
+        if (!teff) {
+          return 1.;
+        }
         int bin = teff->FindFixBin(x, en);
         double result = teff->GetEfficiency(bin);
         return result;
       };
-  std::function<double(double)> vcs_fcn_no_spread =
-      [opts, &born_fcn, &eff, &teff](double en) {
-        if (en <= opts.thsd) {
-          return 0.;
-        }
-        const double s_threshold = opts.thsd * opts.thsd;
-        const double s = en * en;
-        double result = 0;
-        if (teff) {
-          result = convolutionKuraevFadin(en, born_fcn, 0, 1. - s_threshold / s, eff);
-        } else {
-            result = convolutionKuraevFadin(en, born_fcn, 0, 1. - s_threshold / s);
-        }
-        return result;
-      };
-  std::function<double(double)> vcs_fcn =
-      [vmap, opts, &vcs_fcn_no_spread](double en) {
-        double result = 0;
-        if (vmap.count("enable-energy-spread")) {
-          result = gaussian_conv(en, opts.energy_spread * opts.energy_spread,
-                                 vcs_fcn_no_spread);
-        } else {
-          result = vcs_fcn_no_spread(en);
-        }
-        return result;
-      };
-  Eigen::VectorXd tmpRad = Eigen::VectorXd::Zero(opts.n);
+  if (opts.nThreads != 1) {
+    ROOT::EnableThreadSafety();
+  }
+  /**
+   * Kuraev-Fadin rules of the grid points are prepared in parallel,
+   * the fit function is evaluated once at the rule nodes. The detection
+   * efficiency is shared by the threads: its lookups are read-only and
+   * safe after ROOT::EnableThreadSafety().
+   */
+  const std::vector<double> spread(n, opts.energy_spread);
+  RadiatorOperator radiator(opts.thsd, eff);
+  radiator.setPeaks(parseEnergyList(opts.peaks));
+  radiator.setPoints(n, ecm.data(),
+                     vmap.count("enable-energy-spread") ? spread.data() : nullptr,
+                     opts.nThreads);
+  RadiativeCorrectionGrid radGrid(radiator);
+  radGrid.setModel(fit_fcn);
+  Eigen::VectorXd tmpRad = Eigen::VectorXd::Zero(n);
   for (std::size_t iter = 0; iter < opts.niter; ++iter) {
     std::cout << "ITER: " << iter << " / " << opts.niter << std::endl;
-    for (std::size_t i = 0; i < opts.n; ++i) {
-      tmpRad(i) = vcs_fcn(ecm(i)) / born_fcn(ecm(i)) - 1;
-      if (std::isnan(tmpRad(i))) {
-        tmpRad(i) = 0;
-      }
-    }
-    std::copy(tmpRad.data(), tmpRad.data() + opts.n, radCorr.data());
-    gsl_spline_free (spline);
-    gsl_interp_accel_free (acc);
-    acc = gsl_interp_accel_alloc ();
-    spline = gsl_spline_alloc(gsl_interp_linear, opts.n);
-    gsl_spline_init (spline, ecm.data(), radCorr.data(), opts.n);
+    radGrid.iterate(radCorr, &tmpRad);
+    radCorr = tmpRad;
+    gsl_spline_init(spline, ecm.data(), radCorr.data(), n);
+    gsl_interp_accel_reset(acc);
   }
   std::function<double(double*, double*)> rad_fcn =
       [&radFCN](double* x, double*) {
@@ -262,5 +298,8 @@ int main(int argc, char* argv[]) {
   delete ofl;
   gsl_spline_free (spline);
   gsl_interp_accel_free (acc);
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
@@ -2,6 +2,8 @@
 #include <string>
 #include <boost/program_options.hpp>
 #include "IterISRInterpSolver.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -9,9 +11,17 @@ namespace po = boost::program_options;
  */
 typedef struct {
   /**
-   * Number of iterations
+   * Maximum number of iterations
    */
   std::size_t niter;
+  /**
+   * Depth of the Anderson acceleration
+   */
+  std::size_t anderson_depth;
+  /**
+   * Tolerance on the relative change of the radiative correction
+   */
+  double tolerance;
   /**
    * Threshold energy
    */
@@ -20,6 +30,11 @@ typedef struct {
    * Name of the visible cross section graph (TGraphErrors)
    */
   std::string vcs_name;
+  /**
+   * Name of the full visible cross section covariance matrix
+   * (TMatrixD)
+   */
+  std::string vcs_cov_name;
   /**
    * Name of the detection efficiency object (TEfficiency)
    */
@@ -37,6 +52,19 @@ typedef struct {
    * Path to the file with interpolation settings
    */
   std::string interp;
+  /**
+   * Comma-separated list of products to save
+   */
+  std::string products;
+  /**
+   * Target integral operator error in units of the visible
+   * cross section errors (error-controlled assembly)
+   */
+  double assembly_precision;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -46,11 +74,23 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
   desc->add_options()
       ("help,h", "help message")
       ("enable-energy-spread,g", "enable energy spread")
+      ("record-cost", "save per-cell integration cost of the integral operator matrix")
+      ("assembly-precision", po::value<double>(&(opts->assembly_precision)),
+       "enable error-controlled assembly of the integral operator matrix with "
+       "the target error in units of visible cross section errors (e.g. 0.1)")
       ("niter,n", po::value<std::size_t>(&(opts->niter))->default_value(10),
-       "number of iterations")
+       "maximum number of iterations")
+      ("tolerance", po::value<double>(&(opts->tolerance))->default_value(0.),
+       "tolerance on the relative change of the radiative correction "
+       "(0 means that all iterations are performed)")
+      ("anderson-depth", po::value<std::size_t>(&(opts->anderson_depth))->default_value(0),
+       "depth of the Anderson acceleration (0 means plain iterations)")
       ("thsd,t", po::value<double>(&(opts->thsd)), "threshold (GeV)")
       ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
        "name of the visible cross section graph (TGraphErrors*)")
+      ("vcs-cov-name", po::value<std::string>(&(opts->vcs_cov_name)),
+       "name of a full visible cross section covariance matrix (TMatrixD*), "
+       "visible cross section errors are used if not set")
       ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
        "name of the detection efficiency object (TEfficiency*)")
       ( "ifname,i",
@@ -60,7 +100,12 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        po::value<std::string>(&(opts->ofname))->default_value("bcs.root"),
        "Path to output file.")
       ("interp,r", po::value<std::string>(&(opts->interp)),
-       "Path to JSON file with interpolation settings.");
+       "Path to JSON file with interpolation settings.")
+      ("products", po::value<std::string>(&(opts->products))->default_value("all"),
+       "comma-separated list of products to save: vcs, bcs, intop, cov, invcov, "
+       "interp, radcorr, cost or all")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -84,13 +129,33 @@ int main(int argc, char* argv[]) {
   IterISRInterpSolver solver(opts.ifname, {
       .efficiencyName = opts.efficiency_name,
       .visibleCSGraphName = opts.vcs_name,
-      .thresholdEnergy = opts.thsd});
+      .thresholdEnergy = opts.thsd,
+      .vcsCovMatrixName = opts.vcs_cov_name});
   solver.setNumOfIters(opts.niter);
+  solver.setTolerance(opts.tolerance);
+  solver.setAndersonDepth(opts.anderson_depth);
   if (vmap.count("enable-energy-spread")) {
     solver.enableEnergySpread();
   }
+  if (vmap.count("record-cost")) {
+    solver.enableCostRecording();
+  }
+  if (vmap.count("assembly-precision")) {
+    solver.enableErrorControlledAssembly(opts.assembly_precision);
+  }
   solver.solve();
+  const auto& residuals = solver.getResidualHistory();
+  for (std::size_t i = 0; i < residuals.size(); ++i) {
+    std::cout << "iteration " << i + 1 << ": residual = " << residuals[i] << std::endl;
+  }
   solver.save(opts.ofname,
-               {.visibleCSGraphName = opts.vcs_name, .bornCSGraphName = "bcs"});
+               {.visibleCSGraphName = opts.vcs_name, .bornCSGraphName = "bcs",
+                .products = parseOutputProducts(opts.products)});
+  if (vmap.count("assembly-precision")) {
+    solver.printIntegralOperatorErrorBound();
+  }
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
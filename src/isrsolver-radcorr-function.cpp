@@ -1,11 +1,18 @@
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <functional>
 #include <boost/program_options.hpp>
 #include <TFile.h>
 #include <TF1.h>
+#include <TGraph.h>
 #include <TEfficiency.h>
-#include "KuraevFadin.hpp"
+#include <TROOT.h>
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+#include "RadiatorOperator.hpp"
+#include "Utils.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -29,6 +36,10 @@ typedef struct {
    * Maximum center-of-mass energy
    */
   double maxen;
+  /**
+   * Number of worker threads
+   */
+  std::size_t nThreads;
   /**
    * Path to the input .root file that contains
    * Born cross section function
@@ -46,6 +57,14 @@ typedef struct {
    * Path to the output file
    */
   std::string ofname;
+  /**
+   * Comma-separated list of narrow peak energies
+   */
+  std::string peaks;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -59,6 +78,8 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        "number of points to tabulate ratiative correction (delta)")
       ("minen,m",  po::value<double>(&(opts->minen)), "minimum energy")
       ("maxen,x",  po::value<double>(&(opts->maxen)), "maximum energy")
+      ("threads,j", po::value<std::size_t>(&(opts->nThreads))->default_value(1),
+       "number of worker threads (0 means all cores)")
 
       ( "ifname,i",
         po::value<std::string>(&(opts->ifname))->default_value("input.root"),
@@ -70,7 +91,11 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        po::value<std::string>(&(opts->bcs_fcn_name))->default_value("f_bcs"),
        "the name of the Born cross section function (TF1*)")
       ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
-       "name of a detection efficiency object (TEfficiency*)");
+       "name of a detection efficiency object (TEfficiency*)")
+      ("peaks", po::value<std::string>(&(opts->peaks))->default_value(""),
+       "comma-separated list of narrow peak energies (GeV) used as quadrature breakpoints")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -114,45 +139,74 @@ int main(int argc, char* argv[]) {
   }
   fl->Close();
   delete fl;
+  if (opts.nThreads != 1) {
+    ROOT::EnableThreadSafety();
+  }
+  std::vector<double> ens(opts.n);
+  std::vector<double> radcorrs(opts.n);
+  const double step = opts.n > 1 ? (opts.maxen - opts.minen) / (opts.n - 1) : 0.;
+  for (std::size_t i = 0; i < opts.n; ++i) {
+    ens[i] = opts.minen + step * i;
+  }
   /**
-   * Converting the Born cross section function to
-   * a form of std::function
-   */
-  std::function<double(double)> fcn =
-      [fbcs](double energy) {
-        double result = fbcs->Eval(energy);
-        return result;
-      };
-  /**
-   * Converting the detection efficiency to a form
-   * of std::function
+   * Tabulating the radiative correction in parallel. Each chunk
+   * uses its own copy of the Born cross section function (TF1
+   * evaluation is not thread-safe). The detection efficiency is shared:
+   * its lookups are read-only and safe after ROOT::EnableThreadSafety().
    */
-  std::function<double(double, double)> eff =
-      [teff](double x, double en) {
-        int bin = teff->FindFixBin(x, en);
-        double result = teff->GetEfficiency(bin);
-        return result;
-      };
-  std::vector<double> ens;
-  std::vector<double> radcorrs;
-  ens.reserve(opts.n);
-  radcorrs.reserve(opts.n);
-  const double s_th = opts.thsd * opts.thsd;
+  const std::vector<double> peaks = parseEnergyList(opts.peaks);
+  std::mutex cloneMutex;
+  parallelFor(opts.n, opts.nThreads,
+              [&](std::size_t first, std::size_t last) {
+                std::unique_ptr<TF1> localBCS;
+                {
+                  std::lock_guard<std::mutex> lock(cloneMutex);
+                  localBCS.reset(dynamic_cast<TF1*>(fbcs->Clone()));
+                }
+                /**
+                 * Converting the Born cross section function to
+                 * a form of std::function
+                 */
+                std::function<double(double)> fcn =
+                    [&localBCS](double energy) {
+                      double result = localBCS->Eval(energy);
+                      return result;
+                    };
+                /**
+                 * Converting the detection efficiency to a form
+                 * of std::function
+                 */
+                std::function<double(double, double)> eff =
+                    [teff](double x, double en) {
+                      if (!teff) {
+                        return 1.;
+                      }
+                      int bin = teff->FindFixBin(x, en);
+                      double result = teff->GetEfficiency(bin);
+                      return result;
+                    };
+                RadiatorOperator radiator(opts.thsd, eff);
+                radiator.setPeaks(peaks);
+                for (std::size_t i = first; i < last; ++i) {
+                  const double en = ens[i];
+                  const double fe = fcn(en);
+                  if (fe < 1.e-12) {
+                    radcorrs[i] = 0;
+                  } else {
+                    radcorrs[i] = radiator.apply(en, 0., fcn) / fe - 1;
+                  }
+                }
+                std::lock_guard<std::mutex> lock(cloneMutex);
+                localBCS.reset();
+              });
   /**
-   * Creating radiative correction function
+   * Creating radiative correction function that interpolates
+   * the tabulated values, so writing and drawing it is cheap
    */
+  TGraph radGraph(opts.n, ens.data(), radcorrs.data());
   std::function<double(double*, double*)> radcorr_fcn =
-      [s_th, teff,fcn, eff](double* px, double*) {
-        const double en = px[0];
-        const double fe = fcn(en);
-        if (fe < 1.e-12) {
-          return 0.;
-        }
-        if (teff) {
-          double result = convolutionKuraevFadin(en, fcn, 0, 1 - s_th / en / en, eff) / fe - 1;
-          return result;
-        }
-        double result = convolutionKuraevFadin(en, fcn, 0, 1 - s_th / en / en) / fe - 1;
+      [&radGraph](double* px, double*) {
+        double result = radGraph.Eval(px[0]);
         return result;
       };
   TF1 radf("radcorr", &radcorr_fcn, opts.minen, opts.maxen, 0);
@@ -164,8 +218,12 @@ int main(int argc, char* argv[]) {
   auto ofl = TFile::Open(opts.ofname.c_str(), "recreate");
   ofl->cd();
   radf.Write();
+  radGraph.Write("radcorr_graph");
   delete ofl;
   delete fbcs;
   delete teff;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
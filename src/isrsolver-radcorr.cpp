@@ -7,6 +7,7 @@
 #include <TGraph.h>
 #include <TEfficiency.h>
 #include "KuraevFadin.hpp"
+#include "Profiler.hpp"
 namespace po = boost::program_options;
 
 /**
@@ -46,6 +47,10 @@ typedef struct {
    * Output file path
    */
   std::string ofname;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
 } CmdOptions;
 
 /**
@@ -70,7 +75,9 @@ void setOptions(po::options_description* desc, CmdOptions* opts) {
        po::value<std::string>(&(opts->bcs_fcn_name))->default_value("f_bcs"),
        "the name of the Born cross section function (TF1*)")
       ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
-       "name of a detection efficiency object (TEfficiency*)");
+       "name of a detection efficiency object (TEfficiency*)")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report");
 }
 
 /**
@@ -140,5 +147,8 @@ int main(int argc, char* argv[]) {
   gradcorr.Write("radcorr");
   ofl->Close();
   delete ofl;
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
   return 0;
 }
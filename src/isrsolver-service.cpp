@@ -0,0 +1,322 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+#include <nlohmann/json.hpp>
+#include "ISRSolverTikhonov.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
+namespace po = boost::program_options;
+
+/**
+ * A part of program options
+ */
+typedef struct {
+  /**
+   * Threshold energy
+   */
+  double thsd;
+  /**
+   * Regularization parameter
+   */
+  double lambda;
+  /**
+   * Name of the visible cross section graph
+   * (TGraphErrors)
+   */
+  std::string vcs_name;
+  /**
+   * Name of the full visible cross section covariance matrix
+   * (TMatrixD)
+   */
+  std::string vcs_cov_name;
+  /**
+   * Name of the detection efficiency object
+   * (TEfficiency)
+   */
+  std::string efficiency_name;
+  /**
+   * Path to that input .root file that contains
+   * the visible cross section and detection efficiency
+   */
+  std::string ifname;
+  /**
+   * Path to the .json file with interpolation settings
+   */
+  std::string interp;
+  /**
+   * Target integral operator error in units of the visible
+   * cross section errors (error-controlled assembly)
+   */
+  double assembly_precision;
+  /**
+   * Path to the output .json file with the profiling report
+   */
+  std::string profile;
+} CmdOptions;
+
+/**
+ * The exception that is thrown when a request can not be processed
+ */
+typedef struct : std::exception {
+  const char* what() const noexcept {
+    return "[!] Wrong service request.\n";
+  }
+} ServiceRequestException;
+
+/**
+ * Setting up program options
+ */
+void setOptions(po::options_description* desc, CmdOptions* opts) {
+  desc->add_options()
+      ("help,h", "help message")
+      ("thsd,t", po::value<double>(&(opts->thsd)), "threshold energy (GeV)")
+      ("enable-energy-spread,g", "enable energy spread")
+      ("assembly-precision", po::value<double>(&(opts->assembly_precision)),
+       "enable error-controlled assembly of the integral operator matrix with "
+       "the target error in units of visible cross section errors (e.g. 0.1)")
+      ("use-solution-norm2,s",
+       "use the following regularizator: lambda*||solution||^2 if this option is enabled, use lambda*||d(solution) / dE||^2 otherwise")
+      ("lambda,l", po::value<double>(&(opts->lambda)), "regularization parameter (lambda)")
+      ("vcs-name,v", po::value<std::string>(&(opts->vcs_name))->default_value("vcs"),
+       "name of the visible cross section graph (TGraphErrors*)")
+      ("vcs-cov-name", po::value<std::string>(&(opts->vcs_cov_name)),
+       "name of a full visible cross section covariance matrix (TMatrixD*), "
+       "visible cross section errors are used if not set")
+      ("efficiency-name,e", po::value<std::string>(&(opts->efficiency_name)),
+       "name of a detection efficiency object (TEfficiency*)")
+      ("ifname,i",  po::value<std::string>(&(opts->ifname))->default_value("vcs.root"),
+       "path to input file")
+      ("interp,r", po::value<std::string>(&(opts->interp)),
+       "path to JSON file with interpolation settings")
+      ("profile", po::value<std::string>(&(opts->profile)),
+       "path to output JSON file with profiling report (written on exit)");
+}
+
+/**
+ * Help message
+ */
+void help(const po::options_description& desc) {
+  std::cout << desc << std::endl;
+  std::cout << "Requests are read from stdin, one JSON object per line:\n"
+            << "  {\"cmd\": \"update\", \"index\": i, \"vcs\": v, \"vcs_err\": e}"
+            << " (\"energy\" may be used instead of \"index\")\n"
+            << "  {\"cmd\": \"add\", \"energy\": E, \"energy_err\": dE, \"vcs\": v, \"vcs_err\": e}"
+            << " (\"energy_err\" is required with the energy spread)\n"
+            << "  {\"cmd\": \"remove\", \"index\": i}\n"
+            << "  {\"cmd\": \"lambda\", \"lambda\": l}\n"
+            << "  {\"cmd\": \"solve\"}\n"
+            << "  {\"cmd\": \"save\", \"ofname\": \"bcs.root\"}\n"
+            << "  {\"cmd\": \"quit\"}\n"
+            << "Add \"cov\": true to a request to receive the Born cross section"
+            << " covariance matrix. Each request is answered by one JSON line with"
+            << " \"ok\" and the updated Born cross section or \"error\". Errors must be"
+            << " positive." << std::endl;
+}
+
+/**
+ * Index of a point given by "index" or by "energy" in the request
+ * @param solver a solver
+ * @param request a request
+ */
+std::size_t pointIndex(const ISRSolverTikhonov& solver, const nlohmann::json& request) {
+  if (request.contains("index")) {
+    const long index = request.at("index").get<long>();
+    if (index < 0 || index >= static_cast<long>(solver.getN())) {
+      throw ServiceRequestException();
+    }
+    return index;
+  }
+  const double energy = request.at("energy").get<double>();
+  for (std::size_t i = 0; i < solver.getN(); ++i) {
+    if (std::fabs(solver.ecm()(i) - energy) < 1.e-9) {
+      return i;
+    }
+  }
+  throw ServiceRequestException();
+}
+
+/**
+ * Positive value of a request field
+ * @param request a request
+ * @param key a field name
+ */
+double positiveValue(const nlohmann::json& request, const std::string& key) {
+  const double value = request.at(key).get<double>();
+  if (!(value > 0) || !std::isfinite(value)) {
+    throw ServiceRequestException();
+  }
+  return value;
+}
+
+/**
+ * Update visible cross section and (or) its error at a single point.
+ * Only the visible cross section values change if "vcs_err" is not given,
+ * then the solution costs one matrix-vector product. Nothing is changed
+ * if the request is rejected.
+ * @param solver a solver
+ * @param request a request
+ */
+void updatePoint(ISRSolverTikhonov* solver, const nlohmann::json& request) {
+  /**
+   * The whole request is validated before the solver is changed,
+   so that a rejected request has no effect
+   */
+  const std::size_t index = pointIndex(*solver, request);
+  const bool hasVCS = request.contains("vcs");
+  const bool hasVCSErr = request.contains("vcs_err");
+  if (hasVCSErr && solver->isVisibleCSCovMatrixFull()) {
+    throw ServiceRequestException();
+  }
+  const double vcsValue = hasVCS ? request.at("vcs").get<double>() : 0.;
+  const double vcsErrValue = hasVCSErr ? positiveValue(request, "vcs_err") : 0.;
+  if (hasVCS) {
+    Eigen::VectorXd vcs = solver->vcs();
+    vcs(index) = vcsValue;
+    solver->resetVisibleCS(vcs);
+  }
+  if (hasVCSErr) {
+    Eigen::VectorXd vcsErr = solver->vcsErr();
+    vcsErr(index) = vcsErrValue;
+    solver->resetVisibleCSErrors(vcsErr);
+  }
+}
+
+/**
+ * Add a visible cross section point. The center-of-mass energy error is
+ * required if the energy spread is enabled. Nothing is changed if the
+ * request is rejected.
+ * @param solver a solver
+ * @param request a request
+ */
+void addPoint(ISRSolverTikhonov* solver, const nlohmann::json& request) {
+  const double energy = request.at("energy").get<double>();
+  const double energyErr = solver->isEnergySpreadEnabled() ?
+                           positiveValue(request, "energy_err") :
+                           request.value("energy_err", 0.);
+  const double vcs = request.at("vcs").get<double>();
+  const double vcsErr = positiveValue(request, "vcs_err");
+  solver->addPoint(energy, energyErr, vcs, vcsErr);
+}
+
+/**
+ * Solution reply: center-of-mass energies, Born cross section, its errors
+ * and (if requested) its covariance matrix
+ * @param solver a solver
+ * @param withCov add the covariance matrix if true
+ */
+nlohmann::json solution(const ISRSolverTikhonov& solver, bool withCov) {
+  const Eigen::MatrixXd& cov = solver.getBornCSCovMatrix();
+  nlohmann::json result;
+  result["ok"] = true;
+  result["ecm"] = std::vector<double>(solver.ecm().data(),
+                                      solver.ecm().data() + solver.getN());
+  result["bcs"] = std::vector<double>(solver.bcs().data(),
+                                      solver.bcs().data() + solver.getN());
+  std::vector<double> bcsErr(solver.getN());
+  for (std::size_t i = 0; i < solver.getN(); ++i) {
+    bcsErr[i] = std::sqrt(cov(i, i));
+  }
+  result["bcs_err"] = bcsErr;
+  if (withCov) {
+    nlohmann::json rows = nlohmann::json::array();
+    for (Eigen::Index i = 0; i < cov.rows(); ++i) {
+      const Eigen::VectorXd row = cov.row(i);
+      rows.push_back(std::vector<double>(row.data(), row.data() + row.size()));
+    }
+    result["cov"] = rows;
+  }
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc(
+      "   Long-running Tikhonov solver. The integral operator and the factorizations are kept "
+      "between requests, visible cross section updates are read from stdin and the updated "
+      "Born cross section is written to stdout (JSON lines). Allowed options");
+  CmdOptions opts;
+  setOptions(&desc, &opts);
+  po::variables_map vmap;
+  po::store(po::parse_command_line(argc, argv, desc), vmap);
+  po::notify(vmap);
+  if (vmap.count("help")) {
+    help(desc);
+    return 0;
+  }
+  /**
+   * Replies are written to the original stdout, diagnostic messages of
+   the library are redirected to stderr, so that they do not break
+   the protocol
+   */
+  std::ostream reply(std::cout.rdbuf());
+  std::cout.rdbuf(std::cerr.rdbuf());
+  ISRSolverTikhonov solver(opts.ifname, {
+      .efficiencyName = opts.efficiency_name,
+      .visibleCSGraphName = opts.vcs_name,
+      .thresholdEnergy = opts.thsd,
+      .vcsCovMatrixName = opts.vcs_cov_name});
+  solver.enableIncrementalUpdates();
+  if (vmap.count("enable-energy-spread")) {
+    solver.enableEnergySpread();
+  }
+  if (vmap.count("assembly-precision")) {
+    solver.enableErrorControlledAssembly(opts.assembly_precision);
+  }
+  if (vmap.count("interp")) {
+    solver.setRangeInterpSettings(opts.interp);
+  }
+  if (vmap.count("lambda")) {
+    solver.setLambda(opts.lambda);
+  }
+  if (vmap.count("use-solution-norm2")) {
+    solver.disableDerivNorm2Regularizator();
+  }
+  solver.solve();
+  reply << solution(solver, false).dump() << std::endl;
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    nlohmann::json response;
+    try {
+      ISR_PROFILE_SCOPE("service.request");
+      const nlohmann::json request = nlohmann::json::parse(line);
+      const std::string cmd = request.at("cmd").get<std::string>();
+      if (cmd == "quit") {
+        reply << nlohmann::json({{"ok", true}}).dump() << std::endl;
+        break;
+      } else if (cmd == "update") {
+        updatePoint(&solver, request);
+      } else if (cmd == "add") {
+        addPoint(&solver, request);
+      } else if (cmd == "remove") {
+        solver.removePoint(pointIndex(solver, request));
+      } else if (cmd == "lambda") {
+        solver.setLambda(request.at("lambda").get<double>());
+      } else if (cmd == "save") {
+        solver.save(request.value("ofname", std::string("bcs.root")),
+                    {.visibleCSGraphName = opts.vcs_name,
+                     .bornCSGraphName = "bcs",
+                     .products = parseOutputProducts(request.value("products", std::string("all")))});
+      } else if (cmd != "solve") {
+        throw ServiceRequestException();
+      }
+      solver.solve();
+      response = solution(solver, request.value("cov", false));
+    } catch (const std::exception& ex) {
+      response = {{"ok", false}, {"error", ex.what()}};
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    response["milliseconds"] = elapsed.count();
+    reply << response.dump() << std::endl;
+  }
+  std::cout.rdbuf(reply.rdbuf());
+  if (vmap.count("profile")) {
+    Profiler::instance().dump(opts.profile);
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""This tool checks that PyISR.solve_batch returns the energies, the Born
+cross section and its covariance matrix in the same (ascending energy)
+order for sorted and shuffled datasets, and that the energy spread
+without energy errors is rejected."""
+import argparse
+import sys
+import numpy as np
+import PyISR
+
+
+def check(label, ok):
+    print(('[ OK ] ' if ok else '[FAIL] ') + label)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-n', '--npoints', type=int, default=20,
+                        help='number of points')
+    parser.add_argument('-m', '--method', default='SLE',
+                        help='SLE, Tikhonov, TSVD or Iterative')
+    parser.add_argument('-s', '--seed', type=int, default=1,
+                        help='random seed of the shuffle')
+    opts = parser.parse_args()
+    threshold = 0.8
+    energy = np.linspace(0.9, 2.0, opts.npoints)
+    energyErr = np.full(opts.npoints, 1.e-3)
+    vcs = 1. + 0.3 * np.sin(5. * energy)
+    vcsErr = 0.02 * vcs
+    order = np.random.default_rng(opts.seed).permutation(opts.npoints)
+    datasets = [(energy, vcs, energyErr, vcsErr),
+                (energy[order], vcs[order], energyErr[order], vcsErr[order])]
+    nFailed = 0
+    for spread in (False, True):
+        label = opts.method + (', spread' if spread else '')
+        ref, shuffled = PyISR.solve_batch(datasets, threshold, method=opts.method,
+                                          energy_spread=spread)
+        nFailed += not check(label + ': ecm is sorted',
+                             np.array_equal(shuffled['ecm'], energy))
+        nFailed += not check(label + ': bcs matches the sorted dataset',
+                             np.allclose(shuffled['bcs'], ref['bcs'], rtol=1.e-9, atol=0.))
+        nFailed += not check(label + ': bcs_cov_matrix matches the sorted dataset',
+                             np.allclose(shuffled['bcs_cov_matrix'], ref['bcs_cov_matrix'],
+                                         rtol=1.e-9, atol=0.))
+    try:
+        PyISR.solve_batch([(energy, vcs, vcsErr)], threshold, method=opts.method,
+                          energy_spread=True)
+        rejected = False
+    except ValueError:
+        rejected = True
+    nFailed += not check(opts.method + ': energy spread without energy errors is rejected',
+                         rejected)
+    print(('[FAIL] ' if nFailed else '[ OK ] ') + str(nFailed) + ' check(s) failed')
+    return 1 if nFailed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())